@@ -0,0 +1,35 @@
+#ifndef ANALYZE_H
+#define ANALYZE_H
+
+/* analyze a file of positions in EPD or FEN format, one per line, using all */
+/* processors. this is run from the command line as                          */
+/* `chessbot analyze [options] [file]`, reading from standard input when no  */
+/* file is given, with the following options:                                */
+/*                                                                           */
+/* -threads n: the number of positions searched in parallel, defaults to the */
+/* number of processors.                                                     */
+/*                                                                           */
+/* -depth n, -nodes n, -movetime ms: the limits for every search, see        */
+/* `struct search_info`. without limits, positions are searched to depth 4.  */
+/*                                                                           */
+/* only the first four fields of EPD lines are used, any operations after    */
+/* them are ignored. empty lines and lines starting with `#` are skipped.    */
+/* for every other line, one line of JSON is written to standard output, in  */
+/* the order of the input:                                                   */
+/*                                                                           */
+/* {"line":1,"fen":"...","depth":8,"nodes":51234,"score":{"cp":31},          */
+/* "bestmove":"e2e4","pv":["e2e4","e7e5"]}                                   */
+/*                                                                           */
+/* mate scores are written as {"mate":n}, with n negative when the side to   */
+/* move is getting mated. lines that can not be parsed are reported with an  */
+/* "error" field instead. the input is streamed through a fixed number of    */
+/* slots, so nothing is allocated per position and memory use does not       */
+/* depend on the size of the input. every thread keeps its search memory,    */
+/* including the move ordering history, from one position to the next, so    */
+/* with more than one thread the node counts can differ between runs.        */
+/* returns `SUCCESS` on success, `FAILURE` on failure.                       */
+/*                                                                           */
+/* https://www.chessprogramming.org/Extended_Position_Description            */
+int analyze_run(int argc, char **argv);
+
+#endif
@@ -0,0 +1,49 @@
+#ifndef BOOK_H
+#define BOOK_H
+
+#include "move.h"
+#include "position.h"
+
+#include <stddef.h>
+
+/* an opening book stores good moves for positions that are likely to appear */
+/* in the opening, so the engine can play them immediately instead of        */
+/* searching. we read books in the polyglot format: a file of 16 byte        */
+/* entries sorted by the zobrist key of the position, each holding a move    */
+/* and a weight. a position can have several entries, and moves are picked   */
+/* at random in proportion to their weight. because positions are looked up  */
+/* by key, transpositions into a known position are recognized no matter     */
+/* which moves led there.                                                    */
+/*                                                                           */
+/* the file is memory mapped read-only, so opening a book takes no time      */
+/* regardless of its size, and the operating system only loads the pages we  */
+/* actually look at.                                                         */
+/*                                                                           */
+/* https://www.chessprogramming.org/Opening_Book                             */
+/* http://hgm.nubati.net/book_format.html                                    */
+struct book {
+	/* the memory mapped file, `NULL` if no book is open.                    */
+	const unsigned char *data;
+
+	/* the number of entries in the book.                                    */
+	size_t count;
+};
+
+/* open the book at `path`, closing any book that was open before. returns   */
+/* `SUCCESS` on success, `FAILURE` on failure, in which case no book is      */
+/* open.                                                                     */
+int book_open(struct book *book, const char *path);
+
+/* close the book. does nothing if no book is open.                          */
+void book_close(struct book *book);
+
+/* look up the position in the book and store one of its moves in `move`.    */
+/* only moves that are legal in the position are returned. returns `SUCCESS` */
+/* if a move was found, `FAILURE` otherwise.                                 */
+int book_probe(const struct book *book, const struct position *pos, struct move *move);
+
+/* convert a move to the 16 bit format used in book entries. the move must   */
+/* be pseudo-legal for the given position.                                   */
+unsigned int book_encode_move(const struct position *pos, struct move move);
+
+#endif
@@ -0,0 +1,31 @@
+#ifndef BOOKGEN_H
+#define BOOKGEN_H
+
+/* build a polyglot opening book from games in PGN format. this is run from  */
+/* the command line as `chessbot bookgen [options] file.pgn ...`, with the   */
+/* following options:                                                        */
+/*                                                                           */
+/* -o path: where to write the book, defaults to `book.bin`.                 */
+/*                                                                           */
+/* -ply n: only the first `n` plies of every game are added, defaults to 24. */
+/*                                                                           */
+/* -min n: moves played in fewer than `n` games are left out, defaults to 1. */
+/*                                                                           */
+/* -threads n: the number of files parsed in parallel, defaults to the       */
+/* number of processors.                                                     */
+/*                                                                           */
+/* -memory n: the size of the table used to count moves in megabytes,        */
+/* defaults to 256.                                                          */
+/*                                                                           */
+/* the files are streamed, so memory use only depends on the `-memory`       */
+/* option and not on the size of the files. when the table fills up, the     */
+/* moves played in the fewest games are dropped to make room. for every      */
+/* position and move we count the games it was played in and how they ended, */
+/* and the weight of a move in the book is twice the number of wins plus the */
+/* number of draws for the side that played it. games without a result are   */
+/* skipped. returns `SUCCESS` on success, `FAILURE` on failure.              */
+/*                                                                           */
+/* https://www.chessprogramming.org/Portable_Game_Notation                   */
+int bookgen_run(int argc, char **argv);
+
+#endif
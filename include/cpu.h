@@ -0,0 +1,43 @@
+#ifndef CPU_H
+#define CPU_H
+
+/* the engine is built for the oldest x86-64 processors, so one binary runs  */
+/* everywhere, but some hot kernels are also compiled for newer instruction  */
+/* sets and picked when the engine first uses them, by asking the processor  */
+/* with `cpuid`. the kernels are:                                            */
+/*                                                                           */
+/* popcnt: counting the pawns of the pawn structure in `evaluate`.           */
+/*                                                                           */
+/* bmi2: slider attacks with `pext`, an index into a table of the attacks    */
+/* for every occupancy of the rays, instead of scanning the rays for the     */
+/* first piece. `pext` is microcoded and slow on AMD processors before zen   */
+/* 3, so it is not used there.                                               */
+/*                                                                           */
+/* avx2: the material and piece square sum in `evaluate`, gathering the      */
+/* values of 8 squares at a time.                                            */
+/*                                                                           */
+/* the environment variable `CHESSBOT_CPU` limits the features to the ones   */
+/* it names, for example `CHESSBOT_CPU=popcnt` or `CHESSBOT_CPU=generic`,    */
+/* to compare the kernels on one machine. on other architectures and         */
+/* compilers only the generic kernels are built.                             */
+#if defined(__x86_64__) && defined(__GNUC__)
+#define CPU_DISPATCH 1
+#else
+#define CPU_DISPATCH 0
+#endif
+
+enum cpu_feature {
+	CPU_POPCNT = 1,
+	CPU_BMI2 = 2,
+	CPU_AVX2 = 4
+};
+
+/* returns the features the kernels may use, as a combination of the         */
+/* `enum cpu_feature` flags. the processor is only asked once.               */
+int cpu_features(void);
+
+/* returns the names of the features the kernels use, separated by spaces,   */
+/* or "generic" if none, for example to print in a UCI `info string`.        */
+const char *cpu_description(void);
+
+#endif
@@ -42,4 +42,42 @@ size_t generate_pseudo_legal_moves(const struct position *pos, struct move *move
 /* https://www.chessprogramming.org/Double_Check                             */
 size_t generate_legal_moves(const struct position *pos, struct move *moves);
 
+/* returns true if any piece of the given color attacks the square. this     */
+/* looks outwards from the square instead of generating moves. it does not   */
+/* use the attacks kept in the position, so it also works on boards that     */
+/* were changed without `do_move`, like those in `see`. otherwise            */
+/* `ATTACKED_BY` is cheaper.                                                 */
+int is_attacked(const struct position *pos, int square, int color);
+
+/* returns true if the king of the side to move is attacked.                 */
+int in_check(const struct position *pos);
+
+/* returns true if the move, which must be pseudo-legal, gives check. this   */
+/* looks from the enemy king at the destination of the piece, and along the  */
+/* line through the from square for a discovered check, without making the   */
+/* move.                                                                     */
+int gives_check(const struct position *pos, struct move move);
+
+/* generate the quiet moves that give check, directly or by uncovering a     */
+/* slider, and store them in `moves`, which must be large enough to hold     */
+/* all of them. quiet moves are those that capture nothing and do not        */
+/* promote. the moves are pseudo-legal like those of                         */
+/* `generate_pseudo_legal_moves`. returns the number of moves generated.     */
+/*                                                                           */
+/* the squares each piece type checks from are found once from the enemy     */
+/* king, and so are our pieces that block one of our sliders from it, so     */
+/* the other moves are never generated. this is meant for searching checks   */
+/* in quiescence, see `quiescence_checks` in `struct search_params`, and     */
+/* for check extensions.                                                     */
+/*                                                                           */
+/* https://www.chessprogramming.org/Quiet_Moves                              */
+/* https://www.chessprogramming.org/Discovered_Check                         */
+size_t generate_quiet_checks(const struct position *pos, struct move *moves);
+
+/* returns the square of the least valuable piece of the given color that    */
+/* attacks the square, or `NO_SQUARE` if there is none. pins are ignored.    */
+/* sliders behind other pieces are found once those pieces are removed from  */
+/* the board, which is how `see` finds x-ray attackers.                      */
+int least_valuable_attacker(const struct position *pos, int square, int color);
+
 #endif
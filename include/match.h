@@ -0,0 +1,38 @@
+#ifndef MATCH_H
+#define MATCH_H
+
+/* play games between two configurations of the engine, to find out if a     */
+/* change makes it stronger. this is run from the command line as            */
+/* `chessbot match [options]`, with the following options:                   */
+/*                                                                           */
+/* -a config, -b config: the two configurations, as a comma separated list   */
+/* of settings: `tc=base+inc` for a clock with the given seconds and         */
+/* increment, `depth=n`, `nodes=n`, and `movetime=ms`, see `struct           */
+/* search_info`, and any of the search parameters by name, for example       */
+/* `FutilityMargin=120`, see `search_options`. both default to `tc=10+0.1`.  */
+/*                                                                           */
+/* -games n: the largest number of games to play, defaults to 1000.          */
+/*                                                                           */
+/* -threads n: the number of games played at once, defaults to the number    */
+/* of processors.                                                            */
+/*                                                                           */
+/* -openings file: an EPD or FEN file with the positions to start from.      */
+/* every opening is played twice, with each configuration playing both       */
+/* colors. without it, all games start from the initial position.            */
+/*                                                                           */
+/* -sprt elo0 elo1: stop as soon as a sequential probability ratio test      */
+/* decides whether `a` is at most `elo0` or at least `elo1` elo stronger     */
+/* than `b`, defaults to 0 5. -alpha and -beta set the error rates of the    */
+/* test, both default to 0.05.                                               */
+/*                                                                           */
+/* a game ends with checkmate, stalemate, threefold repetition, the fifty    */
+/* move rule, insufficient material, or when a side runs out of time. every  */
+/* configuration keeps its own clock in every game, measured in wall time,   */
+/* so clocks are only meaningful with at most one game per processor. the    */
+/* running score is printed to standard error as games finish.               */
+/*                                                                           */
+/* https://www.chessprogramming.org/Match_Statistics                         */
+/* https://www.chessprogramming.org/Sequential_Probability_Ratio_Test        */
+int match_run(int argc, char **argv);
+
+#endif
@@ -0,0 +1,39 @@
+#ifndef MICROBENCH_H
+#define MICROBENCH_H
+
+/* time the core primitives of the engine one by one, over a large set of    */
+/* positions, to measure the effect of low level changes that a whole search */
+/* would hide in its noise. this is run from the command line as             */
+/* `chessbot microbench [options] [file]`, or with `make microbench`, with   */
+/* the following options:                                                    */
+/*                                                                           */
+/* -positions n: the number of positions, defaults to 10000. they are read   */
+/* from the file in EPD or FEN format, one per line, or otherwise made by    */
+/* playing random games from a few test positions.                           */
+/*                                                                           */
+/* -runs n, -warmup n: the number of timed runs over all positions, 10 by    */
+/* default, and of untimed runs before them, 2 by default.                   */
+/*                                                                           */
+/* -seed n: the seed of the random games, so every build gets the same       */
+/* positions.                                                                */
+/*                                                                           */
+/* -cpu n: the processor to pin the benchmark to, defaults to the one it     */
+/* starts on. -1 leaves it to the scheduler. pinning only works on linux.    */
+/*                                                                           */
+/* the primitives are `generate_pseudo_legal_moves`, `generate_legal_moves`  */
+/* and `evaluate` on every position, `is_legal` on every pseudo legal move,  */
+/* `do_move` on a copy of the position for every legal move, which is how    */
+/* the engine undoes moves, `generate_quiet_checks` on every position,       */
+/* `gives_check` on every legal move, and `parse_position` on the FEN of     */
+/* every position. a table is written to standard error, and one line of     */
+/* JSON for every primitive to standard output, so the results of two        */
+/* builds can be compared:                                                   */
+/*                                                                           */
+/* {"name":"do_move","positions":10000,"ops":383121,"runs":10,               */
+/* "ns_per_op":9.84,"ops_per_sec":101626016,"stddev_ns":0.12,"min_ns":9.70}  */
+/*                                                                           */
+/* the standard deviation is that of the time per operation across runs.     */
+/* returns `SUCCESS` on success, `FAILURE` on failure.                       */
+int microbench_run(int argc, char **argv);
+
+#endif
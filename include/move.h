@@ -39,6 +39,21 @@ struct move make_move(int from_square, int to_square, int promotion_type);
 /* success, `FAILURE` on failure.                                            */
 int parse_move(struct move *move, const char *string);
 
+/* write a move in the notation `parse_move` reads to `buffer`, which must   */
+/* have room for 6 characters. a move from `NO_SQUARE` is written as the     */
+/* null move, 0000.                                                          */
+void format_move(char *buffer, struct move move);
+
+/* parse a move in standard algebraic notation and store the result in       */
+/* `move`. the notation only makes sense for a given position, so the move   */
+/* is resolved by matching it against the legal moves of `pos`. examples:    */
+/* e4, Nbd7, exd5, R1e2, e8=Q+, and O-O. check and annotation symbols are    */
+/* ignored. returns `SUCCESS` on success, `FAILURE` if the string is         */
+/* invalid, or matches no legal move or more than one.                       */
+/*                                                                           */
+/* https://www.chessprogramming.org/Algebraic_Chess_Notation                 */
+int parse_san(struct move *move, const struct position *pos, const char *string);
+
 /* make a move on the position. the move must be pseudo-legal for the given  */
 /* position.                                                                 */
 /*                                                                           */
@@ -55,20 +70,28 @@ int parse_move(struct move *move, const char *string);
 /* https://www.chessprogramming.org/Make_Move                                */
 void do_move(struct position *pos, struct move move);
 
+/* make a null move: pass the turn to the opponent without moving a piece.   */
+/* this is not a legal chess move, it is only used by the search, see        */
+/* `minimax`. the en passant square is cleared and the key is updated, the   */
+/* rest of the position stays the same. the side to move must not be in      */
+/* check.                                                                    */
+/*                                                                           */
+/* https://www.chessprogramming.org/Null_Move                                */
+void do_null_move(struct position *pos);
+
 /* check if a move is legal for the given position. the move must already be */
-/* known to be pseudo-legal.                                                 */
+/* known to be pseudo-legal. when the king is not in check, the attacks kept */
+/* in the position decide king moves, and other moves are legal unless they  */
+/* take a pinned piece off the line between the king and the pinning piece.  */
+/* moves out of check and en passant captures are made on a copy of the      */
+/* position, and are legal if the opponent does not attack the king there.   */
 /*                                                                           */
-/* POSSIBLE IMPROVEMENT: legality test                                       */
-/* for simplicity, to check if a move is legal, we generate all pseudo-legal */
-/* moves for the opponent and check if any of them can capture the king.     */
-/* this is inefficient, and duplicates work that will also be done by the    */
-/* search function. one way to improve this is to instead look from the king */
-/* to the opponent pieces. this way we don't have to generate all opponent   */
-/* moves.                                                                    */
+/* POSSIBLE IMPROVEMENT: check evasions                                      */
+/* out of check, only king moves, captures of the checking piece, and moves  */
+/* onto the line between it and the king can be legal. testing for those     */
+/* would avoid making every move on a copy.                                  */
 /*                                                                           */
 /* https://www.chessprogramming.org/Legal_Move                               */
 int is_legal(const struct position *pos, struct move move);
-char	*opening_move_white( const struct position *pos, int counter);
-char *opening_move_black(const struct position *pos, int *counter);
 
 #endif
\ No newline at end of file
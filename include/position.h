@@ -1,6 +1,7 @@
 #ifndef POSITION_H
 #define POSITION_H
 
+#include <stdint.h>
 #include <stdio.h>
 
 /* this struct represents the placement of pieces on a chess board, as well  */
@@ -8,7 +9,17 @@
 /* possibly an en passant square. we use a square centric approach to store  */
 /* the placement of pieces because it is easy to implement, and being able   */
 /* to quickly look up what piece is on any given square is useful for move   */
-/* generation.                                                               */
+/* generation. next to the board we keep a list of the squares of the pieces */
+/* of each side, so that code that needs all pieces of a side looks at no    */
+/* more than 16 squares instead of 64.                                       */
+/*                                                                           */
+/* the position is copied at every node of the search, so it is kept small:  */
+/* every square and every other field that fits is a single byte, which      */
+/* makes the whole struct 216 bytes, less than four cache lines. the fields  */
+/* read at every node come first, so that the board, the key, the occupied   */
+/* and attacked squares, the side to move, the castling rights and the en    */
+/* passant square all lie in the first 128 bytes. the piece lists and their  */
+/* index, which are mostly used when a move is made, come last.              */
 /*                                                                           */
 /* POSSIBLE IMPROVEMENT: bitboards                                           */
 /* bitboards provide a way to store the placement of pieces on a chess board */
@@ -17,28 +28,125 @@
 /* bitwise operations for move generation. this is more efficient than a     */
 /* square centric approach, but it is also more complicated to implement.    */
 /*                                                                           */
-/* POSSIBLE IMPROVEMENT: draw detection                                      */
-/* to keep the code simple we do not detect draws. to implement draw         */
-/* detection you need to store the number of reversible moves to keep track  */
-/* of the fifty move rule, as well as a history of board states to detect    */
-/* threefold repetition.                                                     */
-/*                                                                           */
 /* https://www.chessprogramming.org/Board_Representation                     */
 /* https://www.chessprogramming.org/Bitboards                                */
 struct position {
 	/* pieces indexed by square. `NO_PIECE` is used for empty squares.       */
-	int board[64];
+	signed char board[64];
+
+	/* zobrist key of the position, kept up to date by `do_move`.            */
+	uint64_t key;
+
+	/* the occupied squares, one bit per square, kept in sync with the board */
+	/* like the piece lists.                                                 */
+	uint64_t occupied;
+
+	/* the squares attacked by each color, one bit per square, split into    */
+	/* the attacks of pawns, knights and the king, and those of bishops,     */
+	/* rooks and queens. `do_move` only recomputes the attacks of pieces     */
+	/* that moved or were captured, and those of sliders with a ray through  */
+	/* a square that changed. anything else that changes the board must call */
+	/* `update_attacks`. use `ATTACKS` and `ATTACKED_BY` to read them.       */
+	uint64_t leaper_attacks[2];
+	uint64_t slider_attacks[2];
 
 	/* color of the current side to move, must be `WHITE` or `BLACK`.        */
-	int side_to_move;
+	signed char side_to_move;
 
 	/* castling rights indexed by piece color.                               */
-	int castling_rights[2];
+	signed char castling_rights[2];
 
 	/* en passant square, may be `NO_SQUARE`.                                */
-	int en_passant_square;
+	signed char en_passant_square;
+
+	/* number of moves since the last capture or pawn move, counted in       */
+	/* plies, for the fifty move rule.                                       */
+	short halfmove_clock;
+
+	/* the squares of the pieces of each color, in no particular order, and  */
+	/* their number. `index` maps every occupied square to its place in the  */
+	/* list of its color, so that a piece can be removed without searching   */
+	/* the list. entries for empty squares are meaningless. use `put_piece`, */
+	/* `remove_piece` and `move_piece` to change the board, they keep the    */
+	/* lists in sync.                                                        */
+	signed char piece_count[2];
+	signed char pieces[2][16];
+	signed char index[64];
+};
+
+/* returns the squares attacked by the pieces of the color.                  */
+#define ATTACKS(pos, color) ((pos)->leaper_attacks[color] | (pos)->slider_attacks[color])
+
+/* returns true if a piece of the color attacks the square. unlike           */
+/* `is_attacked`, this is a single load.                                     */
+#define ATTACKED_BY(pos, square, color) ((int)(ATTACKS(pos, color) >> (square)) & 1)
+
+/* returns the squares a slider on the square attacks in the direction, one  */
+/* of the 8 ray directions of `rays` in `tables.h`: the ray up to and        */
+/* including the first occupied square on it.                                */
+uint64_t ray_attacks(uint64_t occupied, int square, int direction);
+
+/* returns the direction of the ray from the square that goes through the    */
+/* target square, or -1 if they are not on one line.                         */
+int line_direction(int square, int target);
+
+/* returns the lowest square in the set, which must not be empty.            */
+int lowest_square(uint64_t squares);
+
+/* recompute the attacks of the pawns, knights and king of the color.        */
+void update_leaper_attacks(struct position *pos, int color);
+
+/* recompute the attacks of the bishops, rooks and queens of the color.      */
+void update_slider_attacks(struct position *pos, int color);
+
+/* recompute all attacks of both colors. the first call also picks the       */
+/* slider attack kernel for this processor, see `cpu.h`. until then, the     */
+/* generic kernel is used.                                                   */
+void update_attacks(struct position *pos);
+
+/* remove all pieces from the board.                                         */
+void clear_board(struct position *pos);
+
+/* put the piece on the square, which must be empty. a color can have at     */
+/* most 16 pieces.                                                           */
+void put_piece(struct position *pos, int square, int piece);
+
+/* remove the piece from the square, which must not be empty.                */
+void remove_piece(struct position *pos, int square);
+
+/* move the piece on `from_square` to `to_square`, which must be empty.      */
+void move_piece(struct position *pos, int from_square, int to_square);
+
+/* the most keys kept in a `struct history`.                                 */
+#define HISTORY_SIZE 1024
+
+/* to detect repetitions we keep a stack with the keys of all positions      */
+/* before the current one: first those of the game, then those on the path   */
+/* the search took to reach the current position. a position can only repeat */
+/* one that came after the last capture or pawn move, so we never look       */
+/* further back than the halfmove clock, and only at every second entry,     */
+/* where the same side was to move.                                          */
+/*                                                                           */
+/* https://www.chessprogramming.org/Repetitions                              */
+/* https://www.chessprogramming.org/Fifty-move_Rule                          */
+struct history {
+	uint64_t keys[HISTORY_SIZE];
+	int count;
 };
 
+/* push the key of the position onto the stack, before a move is made from   */
+/* it. when the stack is full the oldest half of the keys is dropped.        */
+void history_push(struct history *history, const struct position *pos);
+
+/* pop the key pushed last.                                                  */
+void history_pop(struct history *history);
+
+/* returns true if the position is drawn by the fifty move rule, or repeats  */
+/* a position in the history. a single repetition is enough: if a player     */
+/* can not avoid going back to a position, they can not avoid going back a   */
+/* second time either.                                                       */
+int is_draw(const struct history *history, const struct position *pos);
+
 /* print out information about the position. useful for debugging.           */
 void print_position(const struct position *pos, FILE *stream);
 
@@ -48,4 +156,14 @@ void print_position(const struct position *pos, FILE *stream);
 /* https://www.chessprogramming.org/Forsyth-Edwards_Notation                 */
 int parse_position(struct position *pos, const char *fen);
 
+/* turn a line in EPD or FEN format into a FEN string that `parse_position`  */
+/* accepts: the first four fields, followed by the halfmove clock and        */
+/* fullmove number if the line has them, or `0 1` otherwise. any EPD         */
+/* operations are dropped. `size` is the size of the buffer `fen` points    */
+/* to. returns `SUCCESS` on success, `FAILURE` if there are fewer than four  */
+/* fields or the result does not fit.                                        */
+/*                                                                           */
+/* https://www.chessprogramming.org/Extended_Position_Description            */
+int epd_to_fen(char *fen, size_t size, const char *line);
+
 #endif
@@ -0,0 +1,69 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+/* profiling counts the calls of the hot functions of the engine and the     */
+/* time spent in them, so we can see where a search spends its time before   */
+/* deciding what to optimize. it is compiled in by building with             */
+/* `-DPROFILE=1`, see the `Makefile`, and costs nothing otherwise.           */
+/*                                                                           */
+/* every thread keeps its own counters, so the hot path takes no locks. the  */
+/* counters of a thread are added to the totals by `profile_flush`, which    */
+/* `search` calls when it is done. the times are in cycles of the time stamp */
+/* counter on x86, and in nanoseconds elsewhere. they include nested calls,  */
+/* the `do_move` in `is_legal` counts for both, and the clock itself adds a  */
+/* few dozen cycles to every call.                                           */
+#ifndef PROFILE
+#define PROFILE 0
+#endif
+
+enum profile_counter {
+	PROFILE_SEARCH,
+	PROFILE_GENERATE,
+	PROFILE_LEGAL,
+	PROFILE_DO_MOVE,
+	PROFILE_EVALUATE,
+	PROFILE_COUNTERS
+};
+
+#if PROFILE
+struct profile_timer {
+	uint64_t calls;
+	uint64_t ticks;
+	uint64_t start;
+};
+
+extern __thread struct profile_timer profile_timers[PROFILE_COUNTERS];
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define PROFILE_CLOCK() ((uint64_t)__rdtsc())
+#else
+#define PROFILE_CLOCK() profile_clock()
+#endif
+
+/* returns the current time in nanoseconds.                                  */
+uint64_t profile_clock(void);
+
+/* start and stop timing a call. calls of the same counter must not nest.    */
+#define PROFILE_BEGIN(counter) (profile_timers[counter].start = PROFILE_CLOCK())
+#define PROFILE_END(counter) (profile_timers[counter].ticks += PROFILE_CLOCK() - profile_timers[counter].start, profile_timers[counter].calls++)
+#else
+#define PROFILE_BEGIN(counter) ((void)0)
+#define PROFILE_END(counter) ((void)0)
+#endif
+
+/* add the counters of the calling thread, and the number of nodes it        */
+/* searched, to the totals, and clear them.                                  */
+void profile_flush(uint64_t nodes);
+
+/* clear the totals and the counters of the calling thread.                  */
+void profile_reset(void);
+
+/* print the totals, one line per counter, every line starting with the      */
+/* prefix.                                                                   */
+void profile_report(FILE *stream, const char *prefix);
+
+#endif
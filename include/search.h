@@ -1,28 +1,295 @@
 #ifndef SEARCH_H
 #define SEARCH_H
 
+#include "generate.h"
 #include "position.h"
 #include "move.h"
 
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* the deepest the search goes, in plies from the root.                      */
+#define MAX_DEPTH 64
+
+/* the score of a position where the side to move is checkmated. mates       */
+/* further away score closer to 0, so that the shortest mate is preferred.   */
+#define MATE_SCORE 1000000
+
+/* the number of combinations of a piece and a square, which index the       */
+/* tables of quiet moves in `struct search_state`.                           */
+#define PIECE_SQUARES (12 * 64)
+
+/* the number of move numbers in the table of late move reductions, later    */
+/* moves are reduced like the last one.                                      */
+#define REDUCTION_MOVES 64
+
+/* the number of moves in the move arena of a search. every ply keeps its    */
+/* legal moves there while it searches them, and the ply after it takes the  */
+/* space that follows, which is at most `MAX_MOVES` per ply.                 */
+#define ARENA_MOVES ((MAX_DEPTH + 1) * MAX_MOVES)
+
+/* the tunable parameters of the search, see `minimax`. margins are in       */
+/* centipawns for every ply of remaining depth, and the depths are the       */
+/* largest remaining depth where a technique is used, 0 to turn it off. late */
+/* moves are reduced by `reduction_base / 100 + ln(depth) * ln(move) /       */
+/* (reduction_divisor / 100)` plies, where `move` counts from 1.             */
+struct search_params {
+	int futility_margin;
+	int futility_depth;
+	int reverse_futility_margin;
+	int reverse_futility_depth;
+	int razor_margin;
+	int razor_depth;
+	int reduction_base;
+	int reduction_divisor;
+
+	/* the number of quiet moves searched before the rest are pruned is      */
+	/* `late_move_count + depth * depth`.                                    */
+	int late_move_count;
+	int late_move_depth;
+
+	/* moves are pruned when their static exchange evaluation loses more     */
+	/* than the margin, for captures or quiet moves, for every ply of        */
+	/* remaining depth.                                                      */
+	int see_capture_margin;
+	int see_quiet_margin;
+	int see_depth;
+
+	/* the half width of the first aspiration window, 0 to search without    */
+	/* one, the percentage it grows by every time the score falls outside    */
+	/* of it, and the first depth that uses it.                              */
+	int aspiration_window;
+	int aspiration_growth;
+	int aspiration_depth;
+
+	/* non-zero to also search the quiet moves that give check at the first  */
+	/* ply of quiescence, see `generate_quiet_checks`. off by default, since */
+	/* it costs more nodes than it has been shown to gain.                   */
+	int quiescence_checks;
+
+	/* the reduction of late moves by remaining depth and move number,       */
+	/* filled in from the parameters above by `search_params_init` and       */
+	/* `search_params_set`.                                                  */
+	unsigned char reductions[MAX_DEPTH + 1][REDUCTION_MOVES];
+};
+
+/* a search parameter that can be changed by name, for example as a UCI      */
+/* option. `offset` is the offset of the parameter in `struct                */
+/* search_params`.                                                           */
+struct search_option {
+	const char *name;
+	size_t offset;
+	int default_value;
+	int min;
+	int max;
+};
+
+/* the parameters that can be changed, ending with a `NULL` name.            */
+extern const struct search_option search_options[];
+
+/* set all parameters to their defaults.                                     */
+void search_params_init(struct search_params *params);
+
+/* set the parameter with the given name, clamped to its range. returns      */
+/* `FAILURE` if there is no such parameter.                                  */
+int search_params_set(struct search_params *params, const char *name, int value);
+
+/* lets another thread control a running search, for example the UCI loop    */
+/* while it waits for `stop` or `ponderhit`. the fields are protected by the */
+/* mutex, and the search looks at them every 1024 nodes.                     */
+struct search_control {
+	pthread_mutex_t mutex;
+
+	/* set to make the search return as soon as possible.                    */
+	int stop;
+
+	/* non-zero while the search runs on the opponent's time. the time limit */
+	/* is ignored until it is cleared, and then counts from that moment.     */
+	int ponder;
+};
+
+/* a line found at the root with `multipv`: its score and its principal      */
+/* variation, which starts with the move of the line.                        */
+struct search_line {
+	int score;
+	int pv_length;
+	struct move pv[MAX_DEPTH + 1];
+};
+
+/* the memory a thread searches with, kept from one search to the next, so   */
+/* it is allocated once per thread instead of once per search. a context     */
+/* may only be used by one search at a time.                                 */
+struct search_context {
+	/* the move arena and the ordering scores of its moves, see              */
+	/* `ARENA_MOVES`, so the recursion never puts move lists on the C stack. */
+	/* `NULL` if they could not be allocated, and then the search plays the  */
+	/* first legal move.                                                     */
+	struct move *moves;
+	int *scores;
+
+	/* the lines of the search, `MAX_MOVES` of them, so they can be sorted   */
+	/* by score before they are printed. `NULL` along with the arena if it   */
+	/* could not be allocated.                                               */
+	struct search_line *lines;
+
+	/* the quiet move that last caused a cutoff in reply to a move, by the   */
+	/* piece and destination of that move.                                   */
+	struct move counter_moves[PIECE_SQUARES];
+
+	/* continuation history: how often a quiet move caused a cutoff, after   */
+	/* the moves 1 and 2 plies before it. `continuation[n][before][move]` is */
+	/* indexed by the piece and destination of the move `n + 1` plies before */
+	/* and of the move itself, so that the scores of all moves after the     */
+	/* same move are next to each other. `NULL` if it could not be           */
+	/* allocated, and then quiet moves are only ordered by counter-moves.    */
+	/*                                                                       */
+	/* both are kept from one search to the next, since the moves that were  */
+	/* good in the last search are likely still good in this one. every      */
+	/* search starts by halving the continuation history, so that old        */
+	/* results weigh less than new ones.                                     */
+	int16_t (*continuation)[PIECE_SQUARES][PIECE_SQUARES];
+};
+
+/* allocate the memory of a search context. returns `SUCCESS` on success,    */
+/* `FAILURE` if the move arena could not be allocated.                       */
+int search_context_init(struct search_context *context);
+
+/* free the memory of a search context.                                      */
+void search_context_free(struct search_context *context);
+
 /* information passed to the search function.                                */
 struct search_info {
 	/* a pointer to the position.                                            */
 	const struct position *pos;
 
+	/* the keys of the positions played before it in the game, see           */
+	/* `struct history`. the search pushes its own moves, but leaves the     */
+	/* history as it was when it returns.                                    */
+	struct history *history;
+
 	/* time in milliseconds for both players.                                */
 	int time[2];
 
 	/* increment in milliseconds for both players.                           */
 	int increment[2];
+
+	/* the largest depth, the number of nodes, and the time in milliseconds  */
+	/* to search. 0 means no limit. when no limits and no times are given,   */
+	/* the search goes to a depth of 4.                                      */
+	int depth;
+	unsigned long nodes;
+	int movetime;
+
+	/* non-zero to print a UCI info line after every completed depth.        */
+	int print_info;
+
+	/* the tunable parameters, see `struct search_params`.                   */
+	const struct search_params *params;
+
+	/* the number of best lines to search, each with all moves of the lines  */
+	/* before it excluded at the root. 1 for just the best move.             */
+	int multipv;
+
+	/* the root moves to search, or `NULL` to search all of them.            */
+	const struct move *searchmoves;
+	int searchmoves_count;
+
+	/* a way to stop the search or end pondering from another thread, or     */
+	/* `NULL` if the search only stops at its limits.                        */
+	struct search_control *control;
+	/* the memory to search with, see `struct search_context`.               */
+	struct search_context *context;
 };
 
-/* the return type of `minimax`                                              */
+/* the return type of `search`.                                              */
 struct search_result {
-	/* the best move found for the position passed to `minimax`.             */
+	/* the best move, from `NO_SQUARE` if the side to move has no moves.     */
 	struct move move;
 
-	/* the score of the position passed to `minimax`.                        */
+	/* the score of the position, see `evaluate`.                            */
 	int score;
+
+	/* the last depth that was searched completely, and the number of nodes  */
+	/* searched in total.                                                    */
+	int depth;
+	unsigned long nodes;
+
+	/* the principal variation, the moves both sides are expected to play.   */
+	struct move pv[MAX_DEPTH];
+	int pv_length;
+};
+
+/* everything the search keeps about one ply, see `struct search_state`.     */
+struct search_ply {
+	/* the legal moves of the position at this ply and their ordering        */
+	/* scores, in the move arena right after the moves of the previous ply.  */
+	struct move *moves;
+	int *scores;
+
+	/* the static evaluation of the position, when it is not in check.       */
+	int static_eval;
+
+	/* the piece and destination of the move played at this ply, as          */
+	/* `piece * 64 + square`, or -1 for a null move.                         */
+	int played;
+
+	/* non-zero while a null move is being searched at this ply.             */
+	int null_move;
+
+	/* the principal variation from this ply, made by `minimax` from the     */
+	/* best move and the line of the next ply.                               */
+	struct move pv[MAX_DEPTH + 1];
+	int pv_length;
+};
+
+/* the state of one running search. every search has its own, so several     */
+/* threads can search different positions at the same time.                  */
+struct search_state {
+	const struct search_info *info;
+	struct history *history;
+
+	/* the number of nodes searched so far, and the limit, 0 if none.        */
+	unsigned long nodes;
+	unsigned long max_nodes;
+
+	/* the time the search started in seconds, and the time in milliseconds  */
+	/* after which it has to stop, 0 if none. `stopped` is set once a limit  */
+	/* is reached, after which all scores are meaningless.                   */
+	double start_time;
+	long max_time;
+	int stopped;
+
+	/* non-zero while pondering, see `struct search_control`, and the time   */
+	/* in seconds from which the time limit counts.                          */
+	int pondering;
+	double limit_start;
+
+	/* non-zero while a null move is being verified, see `minimax`.          */
+	int verifying;
+
+	/* the move searched first at the root, usually the best move of the     */
+	/* previous depth. `NO_SQUARE` if there is none.                         */
+	struct move root_move;
+
+	/* the root moves left out of the search, the first moves of the lines   */
+	/* already found at this depth with `multipv`.                           */
+	const struct move *excluded;
+	int excluded_count;
+
+	/* the counter-moves and the continuation history, from the search       */
+	/* context.                                                              */
+	struct move *counter_moves;
+	int16_t (*continuation)[PIECE_SQUARES][PIECE_SQUARES];
+
+	/* the records of all plies, one more than the deepest ply so that a     */
+	/* ply can always prepare the next one.                                  */
+	struct search_ply stack[MAX_DEPTH + 2];
+
+	/* the move arena and the ordering scores of its moves, from the search  */
+	/* context.                                                              */
+	struct move *moves;
+	int *scores;
 };
 
 /* in essence, `minimax` is just another evaluation function. it looks some  */
@@ -37,11 +304,12 @@ struct search_result {
 /* values of all positions after our opponent also moves. and the final      */
 /* value of this position is the maximum of those values. this recursive     */
 /* alternating minimizing and maximizing is where minimax gets its name      */
-/* from. this function returns both the best move and the value of the       */
-/* position.                                                                 */
+/* from. this function returns the value of the position, and stores the     */
+/* best line it found in the principal variation of `state`. positions that  */
+/* are drawn by repetition or the fifty move rule are not searched, and get  */
+/* a score of 0.                                                             */
 /*                                                                           */
-/* POSSIBLE IMPROVEMENT: alpha-beta pruning                                  */
-/* our naive minimax function wastes a lot of time calculating moves for one */
+/* a naive minimax function wastes a lot of time calculating moves for one   */
 /* player, after we have already found a move that is so bad for the other   */
 /* player that they would never want to enter this position anyways. for     */
 /* example, if we are trying to determine the value of a queen move, and we  */
@@ -52,25 +320,62 @@ struct search_result {
 /* different move, we can stop calculating this branch of the search tree.   */
 /* alpha-beta pruning accomplishes this by keeping track of two values,      */
 /* alpha, and beta. alpha is the minimum score that we can surely reach no   */
-/* no matter what our opponent does, and beta is the maximum score that our  */
+/* matter what our opponent does, and beta is the maximum score that our     */
 /* opponent can surely reach no matter what we do. when a move is found with */
 /* a score that falls outside of these bounds, we can stop searching this    */
 /* position, because one of the players is sure to play something else for   */
 /* one of the moves leading up to this position.                             */
 /*                                                                           */
+/* with null move pruning we first let the opponent move twice in a row, by  */
+/* passing our turn with a null move, and search the result with a reduced   */
+/* depth. if our position is still so good that the opponent would avoid it, */
+/* a real move would almost surely be even better, so we can stop without    */
+/* searching any real moves. this assumption fails in zugzwang, where every  */
+/* move makes the position worse, so we do not pass when in check, when we   */
+/* only have pawns left, or right after the opponent passed. at high depths  */
+/* a failing null move search is verified with a reduced search of the real  */
+/* moves, without null moves.                                                */
+/*                                                                           */
+/* moves are searched in order of how likely they are to cause a cutoff: the */
+/* best move of the previous depth at the root, then captures that do not    */
+/* lose material, the most valuable victim first and the least valuable      */
+/* attacker among equal victims, then promotions, and then the quiet moves.  */
+/* the first quiet move is the counter-move, the quiet move that last caused */
+/* a cutoff in reply to the move just played. the others follow by their     */
+/* continuation history, how often they caused a cutoff after the same moves */
+/* 1 and 2 plies before, see `struct search_context`. both are kept from one */
+/* search to the next. captures that lose material by static exchange        */
+/* evaluation, see `see`, come last, after all quiet moves, with the ones    */
+/* that lose the most last, see `ORDER_LOSING_CAPTURE`. out of check, the    */
+/* quiescence search does not search them at all.                            */
+/*                                                                           */
+/* when the depth reaches 0, a quiescence search resolves the captures that  */
+/* are left, so that the evaluation is not called in the middle of an        */
+/* exchange. the side to move may stand pat, taking the evaluation when no   */
+/* capture improves on it. in check all moves are searched, since standing   */
+/* pat is not an option.                                                     */
+/*                                                                           */
+/* the search is selective at shallow depths, outside the principal          */
+/* variation, and never when in check. with reverse futility pruning, a      */
+/* position whose evaluation is above beta by a margin is not searched. with */
+/* razoring, a position whose evaluation is below alpha by a margin is only  */
+/* searched with the quiescence search, and the result is trusted if it      */
+/* stays below alpha. with futility pruning, quiet moves are not searched    */
+/* when the evaluation is so far below alpha that only winning material      */
+/* could help, and with late move count pruning, quiet moves after the first */
+/* few are not searched at all. quiet moves that do not give check are also  */
+/* reduced: late moves are searched with a depth that is smaller for later   */
+/* moves and higher depths, and searched again at the full depth if they     */
+/* turn out to raise alpha. the margins and depths are in `struct            */
+/* search_params`.                                                           */
+/*                                                                           */
 /* POSSIBLE IMPROVEMENT: move ordering                                       */
-/* with alpha-beta pruning implemented, there are suddenly big performance   */
-/* improvements to be had by searching first moves that are likely to be     */
-/* good. why? remember, alpha-beta pruning works by stopping the search of a */
-/* position when a move is found that is so bad for one player that they     */
-/* will surely play something else for one of the moves leading up to this   */
-/* position. so, we want to try these moves that are likely to cause cutoffs */
-/* as soon as possible, so that we might be able to avoid searching the rest */
-/* of the moves. the move ordering key is a sort of mini evaluation function */
-/* for moves instead of positions. captures, promotions, and checks, are     */
-/* often ordered before quiet moves. you can also use results from previous  */
-/* searches to order moves, if some move was good before, it is likely still */
-/* pretty good even if the position is slightly different.                   */
+/* quiet moves are ordered by the counter-move and the continuation history, */
+/* which both depend on the moves before them. near the root, or after a     */
+/* null move, there is little of that to go on, and the quiet moves are      */
+/* searched mostly in the order they were generated. killer moves, the quiet */
+/* moves that caused a cutoff at the same ply, or a history of moves by      */
+/* their squares alone, could order them there too.                          */
 /*                                                                           */
 /* POSSIBLE IMPROVEMENT: transposition table                                 */
 /* in chess, transposition is the act of transitioning from one position     */
@@ -86,62 +391,57 @@ struct search_result {
 /* develop a strategy to replace old entries with ones that are more likely  */
 /* to be useful when you run out of space. see the wiki for more info.       */
 /*                                                                           */
-/* POSSIBLE IMPROVEMENT: quiescence search                                   */
-/* our naive minimax implementation searches every move to the same depth.   */
-/* in practice, it is often better to spend some extra time after the main   */
-/* search depth has been reached to check if there are any moves that could  */
-/* have a big impact on the evaluation, and might result in an inaccurate    */
-/* evaluation if left unresolved. for example if, at the end of our search   */
-/* depth, we reach a position where one player could capture a piece and the */
-/* capturing piece could not be recaptured, then the other player is very    */
-/* likely to lose that piece, and it would be inaccurate to evaluate the     */
-/* position with the piece still on the board. quiescence search extends the */
-/* search after the depth has reached zero, but only considers impactful     */
-/* moves such as captures. when there are no such moves left, the normal     */
-/* evaluation function is called. quiescence search works best when you have */
-/* a special move generator that only generates impactful moves and doesn't  */
-/* waste any time generating quiet moves.                                    */
-/*                                                                           */
 /* https://www.chessprogramming.org/Minimax                                  */
+/* https://www.chessprogramming.org/Principal_Variation                      */
 /* https://www.chessprogramming.org/Alpha-Beta                               */
+/* https://www.chessprogramming.org/Null_Move_Pruning                        */
+/* https://www.chessprogramming.org/MVV-LVA                                  */
+/* https://www.chessprogramming.org/Quiescence_Search                        */
+/* https://www.chessprogramming.org/Reverse_Futility_Pruning                 */
+/* https://www.chessprogramming.org/Razoring                                 */
+/* https://www.chessprogramming.org/Futility_Pruning                         */
+/* https://www.chessprogramming.org/Late_Move_Reductions                     */
 /* https://www.chessprogramming.org/Move_Ordering                            */
+/* https://www.chessprogramming.org/Countermove_Heuristic                    */
+/* https://www.chessprogramming.org/History_Heuristic                        */
+/* https://www.chessprogramming.org/Static_Exchange_Evaluation               */
 /* https://www.chessprogramming.org/Transposition_Table                      */
-/* https://www.chessprogramming.org/Quiescence_Search                        */
-struct search_result minimax(const struct position *pos, int depth);
+int minimax(struct search_state *state, const struct position *pos, int depth, int ply, int alpha, int beta);
 
 /* the search function sets up the search parameters and calls `minimax` to  */
-/* starts searching. our basic implementation always starts a search at a    */
-/* fixed depth of 4.                                                         */
+/* start searching. it uses iterative deepening: instead of trying to guess  */
+/* a search depth that completes in time, it searches at depth 1, then depth */
+/* 2, and so on, until it reaches one of the limits in `info`. this might    */
+/* seem like it wastes a lot of time searching lower depths only to discard  */
+/* the result after searching a higher depth, but in practice this time is   */
+/* insignificant, because a search at even one depth higher takes an order   */
+/* of magnitude longer to complete than all lower depths before it. the best */
+/* move of a depth is searched first at the next depth, which makes          */
+/* alpha-beta pruning more effective. when a limit is reached in the middle  */
+/* of a depth, the result of the previous depth is returned.                 */
 /*                                                                           */
-/* POSSIBLE IMPROVEMENT: time management                                     */
-/* instead of always searching to a fixed depth, come up with a better       */
-/* strategy to effectively use your time. for example, when you are low on   */
-/* time you might want to search to a shallower depth.                       */
+/* from depth `aspiration_depth` on, every depth is first searched with an   */
+/* aspiration window, a narrow window of alpha and beta around the score of  */
+/* the previous depth, which gives a lot more cutoffs. when the score falls  */
+/* outside of the window, the depth is searched again with the window        */
+/* widened on that side by a growing amount, and an info line reports the    */
+/* score as an upper or lower bound.                                         */
 /*                                                                           */
-/* POSSIBLE IMPROVEMENT: iterative deepening                                 */
-/* even if you know how much time you want to spend calculating your next    */
-/* move, how do you decide what depth to search at so that the search        */
-/* completes within the given time? the time it takes to search to a given   */
-/* depth depends on the number of legal moves in the position, the speed of  */
-/* the system the engine is running on, and other things. instead of trying  */
-/* to guess a good depth, you can start with some low depth, such as 2, and  */
-/* incrementally search higher depths when there is still time left. this    */
-/* might seem like it wastes a lot of time searching lower depths only to    */
-/* discard the result after searching a higher depth, but in practice this   */
-/* time is insignificant, because a search at even one depth higher takes an */
-/* order of magnitude longer to complete than all lower depths before it.    */
+/* when playing on a clock without other limits, the search spends a fixed   */
+/* part of the remaining time and the increment on the move.                 */
 /*                                                                           */
-/* POSSIBLE IMPROVEMENT: opening book                                        */
-/* a deterministic chess engine will always output the same move when given  */
-/* the same position. so instead of wasting time calculating the best move   */
-/* in the starting position, you can instead precalculate the best move and  */
-/* return it immediately. you can also precalculate moves for common         */
-/* openings (for example, what to do after 1. e4 e5?), and endgames.         */
+/* the opening book is not looked at here: the UCI loop plays book moves     */
+/* without calling `search`, see `book.h`.                                   */
+/*                                                                           */
+/* POSSIBLE IMPROVEMENT: time management                                     */
+/* come up with a better strategy to effectively use your time. for example, */
+/* you might spend more time when the best move keeps changing between       */
+/* depths, and less when it is obvious.                                      */
 /*                                                                           */
 /* https://www.chessprogramming.org/Search                                   */
 /* https://www.chessprogramming.org/Time_Management                          */
 /* https://www.chessprogramming.org/Iterative_Deepening                      */
-/* https://www.chessprogramming.org/Opening_Book                             */
-struct move search(const struct search_info *info);
+/* https://www.chessprogramming.org/Aspiration_Windows                       */
+struct search_result search(const struct search_info *info);
 
 #endif
@@ -0,0 +1,21 @@
+#ifndef SEE_H
+#define SEE_H
+
+#include "move.h"
+#include "position.h"
+
+/* static exchange evaluation. returns the material the side to move wins    */
+/* with the move, in centipawns, when both sides keep capturing on the       */
+/* destination square with their least valuable piece, and each side may     */
+/* stop capturing when that is better for them. a negative value means the   */
+/* move loses material. attackers behind other attackers, x-rays, join the   */
+/* exchange once the pieces in front of them have captured. pins and checks  */
+/* are ignored, except that the king never captures onto a square that is    */
+/* still attacked. quiet moves are evaluated too, as an exchange that starts */
+/* by putting the piece on the square.                                       */
+/*                                                                           */
+/* https://www.chessprogramming.org/Static_Exchange_Evaluation               */
+/* https://www.chessprogramming.org/SEE_-_The_Swap_Algorithm                 */
+int see(const struct position *pos, struct move move);
+
+#endif
@@ -0,0 +1,135 @@
+#ifndef TABLEBASE_H
+#define TABLEBASE_H
+
+#include "move.h"
+#include "position.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* endgame tablebases store the exact outcome of every position with a given */
+/* set of pieces, so once few enough pieces are left on the board the engine */
+/* no longer needs to search or evaluate: it simply looks up the result. our */
+/* tables are generated locally with `chessbot tbgen`, see `tbgen.h`, for up */
+/* to `TB_MAX_PIECES` pieces including the kings.                            */
+/*                                                                           */
+/* every table covers one material signature, such as `KRPvKR`, for both     */
+/* sides to move, and is stored in its own file named after the signature    */
+/* with a `.tb` extension. the file holds a 16 byte header followed by two   */
+/* arrays indexed by position: the win/draw/loss (WDL) value from the        */
+/* perspective of the side to move packed in 2 bits, and the distance to     */
+/* zeroing (DTZ) in 1 byte. the DTZ is the number of plies until the next    */
+/* capture or pawn move with best play, which is enough to make progress in  */
+/* a won position without knowing the distance to mate. the files are memory */
+/* mapped, so only the parts we actually probe are read from disk.           */
+/*                                                                           */
+/* positions are indexed by piece squares, using the symmetry of the board   */
+/* to store each position only once: for pawnless tables the white king is   */
+/* restricted to the a1-d1-d4 triangle, for tables with pawns to the a to d  */
+/* files. the tables ignore castling and en passant, so positions with       */
+/* castling rights or an en passant square are never probed, and draws by    */
+/* the fifty move rule are not taken into account.                           */
+/*                                                                           */
+/* https://www.chessprogramming.org/Endgame_Tablebases                       */
+/* https://www.chessprogramming.org/Retrograde_Analysis                      */
+#define TB_MAX_PIECES 5
+
+/* values stored in the tables, from the perspective of the side to move.    */
+#define TB_LOSS 0
+#define TB_DRAW 1
+#define TB_WIN 2
+#define TB_ILLEGAL 3
+
+/* load all tables found in the directory `path`, unloading any tables that  */
+/* were loaded before. returns the number of tables loaded.                  */
+int tb_init(const char *path);
+
+/* unload all tables.                                                        */
+void tb_free(void);
+
+/* returns the largest number of pieces for which a table is loaded, or 0 if */
+/* no tables are loaded.                                                     */
+int tb_largest(void);
+
+/* look up the position and store its value in `wdl`. returns `SUCCESS` on   */
+/* success, `FAILURE` if there is no table for the position or the position  */
+/* has castling rights or an en passant square.                              */
+int tb_probe_wdl(const struct position *pos, int *wdl);
+
+/* like `tb_probe_wdl`, but also stores the distance to zeroing in `dtz`.    */
+int tb_probe_dtz(const struct position *pos, int *wdl, int *dtz);
+
+/* pick a move that keeps the best possible result, as stored in `wdl`. won  */
+/* positions are converted by moving closer to a capture or pawn move, lost  */
+/* positions are defended by staying away from them as long as possible.     */
+/* returns `SUCCESS` on success, `FAILURE` if the position can not be probed */
+/* or any of the positions after a legal move can not be probed.            */
+int tb_probe_root(const struct position *pos, struct move *move, int *wdl);
+
+/* the rest of this file is used by the generator.                           */
+
+/* a table for one material signature. the pieces are listed in the order    */
+/* they are indexed: the white king, the black king, and then the remaining  */
+/* white and black pieces, from queen to pawn.                               */
+struct tb_table {
+	char name[16];
+	int pieces[TB_MAX_PIECES];
+	int count;
+
+	/* non-zero if the table has pawns.                                      */
+	int pawns;
+
+	/* material key of the signature, see `tb_material`.                     */
+	uint32_t material;
+
+	/* number of positions for each side to move.                            */
+	uint64_t size;
+
+	/* the memory mapped file, `NULL` if the table is not loaded.            */
+	const unsigned char *data;
+	size_t data_size;
+};
+
+/* set up a table for the given material signature, without loading it.     */
+/* returns `SUCCESS` on success, `FAILURE` if the signature is invalid or    */
+/* has too many pieces.                                                      */
+int tb_setup(struct tb_table *table, const char *name);
+
+/* list the signatures of all tables with at most `max_pieces` pieces, with  */
+/* the stronger side as white. `names` must have room for `max_names`        */
+/* signatures. returns the number of signatures.                             */
+int tb_names(char (*names)[16], int max_names, int max_pieces);
+
+/* write the signature for the given piece counts to `name`, which must have */
+/* room for 16 characters. the counts are indexed by color and by piece from */
+/* queen to pawn. the stronger side is written first.                        */
+void tb_signature(char *name, int counts[2][5]);
+
+/* returns the material key of the position. positions with the same pieces */
+/* have the same key.                                                        */
+uint32_t tb_material(const struct position *pos);
+
+/* returns the index of the position in the table, including the side to     */
+/* move. the position must have the material of the table, with either       */
+/* color as the stronger side.                                               */
+uint64_t tb_index(const struct tb_table *table, const struct position *pos);
+
+/* set up the position for an index, with no castling rights or en passant   */
+/* square. returns `SUCCESS` on success, `FAILURE` if two pieces share a     */
+/* square or the index is not the one `tb_index` returns for the position.   */
+/* the position may still be illegal.                                        */
+int tb_decode(const struct tb_table *table, uint64_t index, struct position *pos);
+
+/* load the table from the directory `path` and make it available for        */
+/* probing. returns `SUCCESS` on success, `FAILURE` on failure.              */
+int tb_load(const char *path, const char *name);
+
+/* write a table to the directory `path`. `wdl` and `dtz` hold one value per */
+/* index. returns `SUCCESS` on success, `FAILURE` on failure.                */
+int tb_write(const char *path, const struct tb_table *table, const unsigned char *wdl, const unsigned char *dtz);
+
+/* like `tb_probe_dtz`, but also probes positions with castling rights or an */
+/* en passant square, ignoring both. positions with only kings are draws.    */
+int tb_lookup(const struct position *pos, int *wdl, int *dtz);
+
+#endif
@@ -0,0 +1,32 @@
+#ifndef TBGEN_H
+#define TBGEN_H
+
+/* generate endgame tablebases, see `tablebase.h`. this is run from the      */
+/* command line as `chessbot tbgen [options] table ...`, where every table   */
+/* is either a material signature such as `KRPvKR`, or a number of pieces to */
+/* generate all tables with at most that many pieces. tables that are needed */
+/* to generate a table, because a capture or promotion leads to them, are    */
+/* generated first. tables that already exist are not generated again. the   */
+/* options are:                                                              */
+/*                                                                           */
+/* -path dir: the directory to store the tables in, defaults to the current  */
+/* directory.                                                                */
+/*                                                                           */
+/* -threads n: the number of threads to use, defaults to the number of       */
+/* processors.                                                               */
+/*                                                                           */
+/* the tables are generated with retrograde analysis. first, every position  */
+/* is examined once to find checkmates, stalemates, and positions that are   */
+/* decided by a capture or promotion into a smaller table. then, starting    */
+/* from the decided positions, we work backwards by generating the moves     */
+/* that could have led to them, called unmoves. a position is won if any     */
+/* move leads to a lost position for the opponent, and lost if all moves     */
+/* lead to won positions for the opponent, so for every position we count    */
+/* the moves that have not been shown to lose yet. positions that are still  */
+/* undecided when nothing changes anymore are draws. the distance to zeroing */
+/* is found the same way in a second round, where only moves that are not    */
+/* captures or pawn moves are taken back. returns `SUCCESS` on success,      */
+/* `FAILURE` on failure.                                                     */
+int tbgen_run(int argc, char **argv);
+
+#endif
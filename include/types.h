@@ -60,6 +60,10 @@
 /* returns the type of the given piece.                                      */
 #define TYPE(piece) ((piece) / 2)
 
+/* returns true if pieces of the type slide along rays: bishops, rooks, and  */
+/* queens.                                                                   */
+#define SLIDER(type) ((type) >= BISHOP && (type) <= QUEEN)
+
 /* returns the rank from the perspective of the given color.                 */
 #define RELATIVE(rank, color) ((color) == WHITE ? (rank) : 7 - (rank))
 
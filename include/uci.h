@@ -4,11 +4,24 @@
 /* Universal Chess Interface is a protocol that chess GUIs use to talk to    */
 /* chess engines. this function is called from `main` and handles            */
 /* communication with the GUI. it's all just boring text parsing stuff, so   */
-/* i'll spare you the details. do note that we only implement the bare       */
-/* minimum required to play a game of chess, other stuff like pondering and  */
-/* search options are not implemented.                                       */
+/* i'll spare you the details. the search runs on its own thread, so `stop`  */
+/* and `ponderhit` are handled while it runs. with `go ponder` the engine    */
+/* thinks on the opponent's time about the move it sent as `ponder`, and     */
+/* `ponderhit` turns that into a normal timed search. the options are        */
+/* `BookFile`, the path of a polyglot opening book, see `book.h`,            */
+/* `TablebasePath`, the directory with the endgame tablebases, see           */
+/* `tablebase.h`, `MultiPV`, the number of best lines to show, and the       */
+/* tunable parameters of the search, see `search_options`. `go searchmoves`  */
+/* limits the search to the moves that follow it. `profile` prints the       */
+/* profiling counters as `info string` lines, and `profile reset` clears     */
+/* them, see `profile.h`.                                                    */
 /*                                                                           */
 /* https://www.chessprogramming.org/UCI                                      */
 void uci_run(const char *name, const char *author);
 
+/* write a line to standard output, formatted like `printf`. the search      */
+/* thread and the UCI loop both write with this, and every call is written   */
+/* at once and flushed while holding a mutex, so their lines never mix.      */
+void uci_print(const char *format, ...);
+
 #endif
@@ -0,0 +1,47 @@
+#ifndef ZOBRIST_H
+#define ZOBRIST_H
+
+#include "position.h"
+
+#include <stdint.h>
+
+/* zobrist hashing assigns a random 64 bit number to every feature of a      */
+/* position: each piece on each square, each castling right, the en passant  */
+/* file, and the side to move. the key of a position is the exclusive or of  */
+/* the numbers of all features that are present. because exclusive or is its */
+/* own inverse, a move only has to toggle the few features it changes, which */
+/* is what `do_move` does to keep `pos->key` up to date.                     */
+/*                                                                           */
+/* the layout of the table and the rules for which features are included     */
+/* follow the polyglot opening book format, so the key of a position can be  */
+/* used directly to look it up in a book. the numbers for the pawns,         */
+/* knights, bishops and rooks, the castling rights, the en passant files and */
+/* the side to move are the `Random64` values from the polyglot sources, but */
+/* the numbers for the queens and kings are not, so every key differs from   */
+/* the polyglot key and books made by other tools cannot be read yet. `make  */
+/* test` checks the keys of the example positions of the format description  */
+/* and fails until the table is complete.                                    */
+/*                                                                           */
+/* https://www.chessprogramming.org/Zobrist_Hashing                          */
+/* http://hgm.nubati.net/book_format.html                                    */
+extern const uint64_t zobrist_random[781];
+
+/* returns the number for the given piece on the given square.               */
+#define ZOBRIST_PIECE(piece, square) (zobrist_random[64 * ((piece) ^ 1) + (square)])
+
+/* returns the number for the side to move, which is only included when it   */
+/* is white's turn.                                                          */
+#define ZOBRIST_TURN (zobrist_random[780])
+
+/* returns the castling part of the key of the position.                     */
+uint64_t zobrist_castling(const struct position *pos);
+
+/* returns the en passant part of the key of the position. the en passant    */
+/* file is only included if a pawn of the side to move can actually capture  */
+/* en passant, whether or not that capture is legal.                         */
+uint64_t zobrist_en_passant(const struct position *pos);
+
+/* compute the key of the position from scratch.                             */
+uint64_t zobrist_key(const struct position *pos);
+
+#endif
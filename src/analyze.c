@@ -0,0 +1,347 @@
+#define _POSIX_C_SOURCE 200112L
+
+#include "analyze.h"
+#include "position.h"
+#include "search.h"
+#include "types.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/* the longest line we read, longer lines are reported as invalid.           */
+#define MAX_LINE 1024
+
+/* the longest line we write: the FEN, the principal variation, and some     */
+/* numbers.                                                                  */
+#define MAX_OUTPUT (MAX_LINE + MAX_DEPTH * 9 + 256)
+
+/* the number of slots for every thread, so that threads can keep working    */
+/* while a slow position holds up the output.                                */
+#define SLOTS_PER_THREAD 16
+
+/* a line of input on its way through the threads. a slot is filled by the   */
+/* reader, claimed and searched by a worker, and then written and reused by  */
+/* the reader.                                                               */
+struct slot {
+	unsigned long line_number;
+	int done;
+	char line[MAX_LINE];
+	char output[MAX_OUTPUT];
+};
+
+struct analyze {
+	FILE *input;
+	int thread_count;
+	int depth;
+	unsigned long nodes;
+	int movetime;
+	struct search_params params;
+
+	struct slot *slots;
+	unsigned long slot_count;
+
+	/* everything below is shared between threads and protected by `mutex`.  */
+	/* slots are used in order: `written` counts the slots that have been    */
+	/* written, `claimed` the slots handed to workers, and `read` the slots  */
+	/* filled with a line. the slot for a count is `count % slot_count`.     */
+	pthread_mutex_t mutex;
+	pthread_cond_t line_ready;
+	pthread_cond_t result_ready;
+	unsigned long written;
+	unsigned long claimed;
+	unsigned long read;
+	int finished;
+};
+
+/* the state of a worker thread, reused for all its positions.               */
+struct worker {
+	struct analyze *analyze;
+	struct position pos;
+	struct history history;
+	struct search_context context;
+	pthread_t thread;
+};
+
+/* search the position on a line and write the result to the slot.           */
+static void analyze_line(struct worker *worker, struct slot *slot) {
+	struct analyze *analyze = worker->analyze;
+	struct search_info info;
+	struct search_result result;
+	char fen[MAX_LINE];
+	char move[8];
+	char *output = slot->output;
+	int index;
+
+	if (strlen(slot->line) + 1 >= MAX_LINE || epd_to_fen(fen, sizeof fen, slot->line) != SUCCESS || parse_position(&worker->pos, fen) != SUCCESS) {
+		sprintf(output, "{\"line\":%lu,\"error\":\"invalid position\"}\n", slot->line_number);
+
+		return;
+	}
+
+	if (!worker->context.moves) {
+		sprintf(output, "{\"line\":%lu,\"error\":\"out of memory\"}\n", slot->line_number);
+
+		return;
+	}
+
+	worker->history.count = 0;
+	info.pos = &worker->pos;
+	info.history = &worker->history;
+	info.time[WHITE] = 0;
+	info.time[BLACK] = 0;
+	info.increment[WHITE] = 0;
+	info.increment[BLACK] = 0;
+	info.depth = analyze->depth;
+	info.nodes = analyze->nodes;
+	info.movetime = analyze->movetime;
+	info.print_info = 0;
+	info.params = &analyze->params;
+	info.multipv = 1;
+	info.searchmoves = NULL;
+	info.searchmoves_count = 0;
+	info.control = NULL;
+	info.context = &worker->context;
+
+	result = search(&info);
+
+	output += sprintf(output, "{\"line\":%lu,\"fen\":\"%s\",\"depth\":%d,\"nodes\":%lu,", slot->line_number, fen, result.depth, result.nodes);
+
+	if (result.score >= MATE_SCORE - MAX_DEPTH) {
+		output += sprintf(output, "\"score\":{\"mate\":%d},", (MATE_SCORE - result.score + 1) / 2);
+	} else if (result.score <= -MATE_SCORE + MAX_DEPTH) {
+		output += sprintf(output, "\"score\":{\"mate\":%d},", -(MATE_SCORE + result.score) / 2);
+	} else {
+		output += sprintf(output, "\"score\":{\"cp\":%d},", result.score);
+	}
+
+	if (result.move.from_square == NO_SQUARE) {
+		output += sprintf(output, "\"bestmove\":null,\"pv\":[");
+	} else {
+		format_move(move, result.move);
+		output += sprintf(output, "\"bestmove\":\"%s\",\"pv\":[", move);
+	}
+
+	for (index = 0; index < result.pv_length; index++) {
+		format_move(move, result.pv[index]);
+		output += sprintf(output, "%s\"%s\"", index > 0 ? "," : "", move);
+	}
+
+	sprintf(output, "]}\n");
+}
+
+static void *analyze_worker(void *arg) {
+	struct worker *worker = arg;
+	struct analyze *analyze = worker->analyze;
+
+	/* without its memory the worker still takes its share of the lines, and */
+	/* reports them as errors.                                               */
+	search_context_init(&worker->context);
+	pthread_mutex_lock(&analyze->mutex);
+
+	for (;;) {
+		struct slot *slot;
+
+		while (analyze->claimed == analyze->read && !analyze->finished) {
+			pthread_cond_wait(&analyze->line_ready, &analyze->mutex);
+		}
+
+		if (analyze->claimed == analyze->read) {
+			break;
+		}
+
+		slot = &analyze->slots[analyze->claimed++ % analyze->slot_count];
+		pthread_mutex_unlock(&analyze->mutex);
+
+		analyze_line(worker, slot);
+
+		pthread_mutex_lock(&analyze->mutex);
+		slot->done = 1;
+		pthread_cond_signal(&analyze->result_ready);
+	}
+
+	pthread_mutex_unlock(&analyze->mutex);
+	search_context_free(&worker->context);
+
+	return NULL;
+}
+
+/* returns true if the line has no position.                                 */
+static int skip_line(const char *line) {
+	line += strspn(line, " \t\r\n");
+
+	return !*line || *line == '#';
+}
+
+/* read lines into free slots and write the results of finished slots in     */
+/* order, until the input ends and all results are written. returns the      */
+/* number of positions.                                                      */
+static unsigned long run_reader(struct analyze *analyze) {
+	unsigned long line_number = 0;
+	int reading = 1;
+
+	pthread_mutex_lock(&analyze->mutex);
+
+	for (;;) {
+		struct slot *slot = &analyze->slots[analyze->written % analyze->slot_count];
+
+		/* the slots between `written` and `read` are owned by the workers   */
+		/* until they are done, the others belong to the reader.             */
+		if (analyze->written < analyze->read && slot->done) {
+			pthread_mutex_unlock(&analyze->mutex);
+			fputs(slot->output, stdout);
+			pthread_mutex_lock(&analyze->mutex);
+			slot->done = 0;
+			analyze->written++;
+		} else if (reading && analyze->read - analyze->written < analyze->slot_count) {
+			slot = &analyze->slots[analyze->read % analyze->slot_count];
+			pthread_mutex_unlock(&analyze->mutex);
+
+			do {
+				reading = fgets(slot->line, sizeof slot->line, analyze->input) != NULL;
+				line_number++;
+
+				/* skip the rest of lines that are too long.                 */
+				if (reading && !strchr(slot->line, '\n')) {
+					int c;
+
+					while ((c = getc(analyze->input)) != EOF && c != '\n') {
+					}
+				}
+			} while (reading && skip_line(slot->line));
+
+			pthread_mutex_lock(&analyze->mutex);
+
+			if (reading) {
+				slot->line_number = line_number;
+				slot->done = 0;
+				analyze->read++;
+				pthread_cond_signal(&analyze->line_ready);
+			}
+		} else if (!reading && analyze->written == analyze->read) {
+			break;
+		} else {
+			pthread_cond_wait(&analyze->result_ready, &analyze->mutex);
+		}
+	}
+
+	analyze->finished = 1;
+	pthread_cond_broadcast(&analyze->line_ready);
+	pthread_mutex_unlock(&analyze->mutex);
+	fflush(stdout);
+
+	return analyze->read;
+}
+
+static int parse_options(struct analyze *analyze, int argc, char **argv) {
+	int index;
+
+	analyze->input = stdin;
+	analyze->thread_count = (int)sysconf(_SC_NPROCESSORS_ONLN);
+	analyze->depth = 0;
+	analyze->nodes = 0;
+	analyze->movetime = 0;
+	search_params_init(&analyze->params);
+
+	for (index = 0; index < argc && argv[index][0] == '-'; index += 2) {
+		const char *option = argv[index];
+		const char *value = index + 1 < argc ? argv[index + 1] : NULL;
+
+		if (!value) {
+			return FAILURE;
+		} else if (!strcmp(option, "-threads")) {
+			analyze->thread_count = atoi(value);
+		} else if (!strcmp(option, "-depth")) {
+			analyze->depth = atoi(value);
+		} else if (!strcmp(option, "-nodes")) {
+			analyze->nodes = strtoul(value, NULL, 10);
+		} else if (!strcmp(option, "-movetime")) {
+			analyze->movetime = atoi(value);
+		} else {
+			return FAILURE;
+		}
+	}
+
+	if (argc - index > 1 || analyze->depth < 0 || analyze->movetime < 0) {
+		return FAILURE;
+	}
+
+	if (index < argc && !(analyze->input = fopen(argv[index], "r"))) {
+		fprintf(stderr, "analyze: could not open %s\n", argv[index]);
+
+		return FAILURE;
+	}
+
+	if (analyze->thread_count < 1) {
+		analyze->thread_count = 1;
+	}
+
+	return SUCCESS;
+}
+
+int analyze_run(int argc, char **argv) {
+	struct analyze analyze;
+	struct worker *workers;
+	struct timespec start;
+	struct timespec end;
+	unsigned long count;
+	double seconds;
+	int index;
+
+	if (parse_options(&analyze, argc, argv) != SUCCESS) {
+		fprintf(stderr, "usage: analyze [-threads n] [-depth n] [-nodes n] [-movetime ms] [file]\n");
+
+		return FAILURE;
+	}
+
+	analyze.slot_count = (unsigned long)analyze.thread_count * SLOTS_PER_THREAD;
+	analyze.slots = malloc(analyze.slot_count * sizeof *analyze.slots);
+	workers = malloc(analyze.thread_count * sizeof *workers);
+
+	if (!analyze.slots || !workers) {
+		fprintf(stderr, "analyze: out of memory\n");
+		free(analyze.slots);
+		free(workers);
+
+		return FAILURE;
+	}
+
+	pthread_mutex_init(&analyze.mutex, NULL);
+	pthread_cond_init(&analyze.line_ready, NULL);
+	pthread_cond_init(&analyze.result_ready, NULL);
+	analyze.written = 0;
+	analyze.claimed = 0;
+	analyze.read = 0;
+	analyze.finished = 0;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	for (index = 0; index < analyze.thread_count; index++) {
+		workers[index].analyze = &analyze;
+		pthread_create(&workers[index].thread, NULL, analyze_worker, &workers[index]);
+	}
+
+	count = run_reader(&analyze);
+
+	for (index = 0; index < analyze.thread_count; index++) {
+		pthread_join(workers[index].thread, NULL);
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+	fprintf(stderr, "%lu positions in %.2fs, %.1f positions per second\n", count, seconds, count / (seconds > 0 ? seconds : 1));
+
+	if (analyze.input != stdin) {
+		fclose(analyze.input);
+	}
+
+	pthread_cond_destroy(&analyze.result_ready);
+	pthread_cond_destroy(&analyze.line_ready);
+	pthread_mutex_destroy(&analyze.mutex);
+	free(analyze.slots);
+	free(workers);
+
+	return SUCCESS;
+}
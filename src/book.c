@@ -0,0 +1,193 @@
+#define _POSIX_C_SOURCE 200112L
+
+#include "book.h"
+#include "generate.h"
+#include "types.h"
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* every entry is a 64 bit key, a 16 bit move, a 16 bit weight, and a 32    */
+/* bit learn value, all stored big endian.                                   */
+#define ENTRY_SIZE 16
+
+/* read a big endian number of `size` bytes.                                 */
+static uint64_t read_number(const unsigned char *data, int size) {
+	uint64_t number = 0;
+	int index;
+
+	for (index = 0; index < size; index++) {
+		number = number << 8 | data[index];
+	}
+
+	return number;
+}
+
+static uint64_t entry_key(const struct book *book, size_t index) {
+	return read_number(book->data + index * ENTRY_SIZE, 8);
+}
+
+static unsigned int entry_move(const struct book *book, size_t index) {
+	return (unsigned int)read_number(book->data + index * ENTRY_SIZE + 8, 2);
+}
+
+static unsigned int entry_weight(const struct book *book, size_t index) {
+	return (unsigned int)read_number(book->data + index * ENTRY_SIZE + 10, 2);
+}
+
+/* convert a move from the book format. bits 0 to 5 hold the to square, bits */
+/* 6 to 11 the from square, and bits 12 to 14 the promotion type. castling   */
+/* is stored as the king capturing its own rook.                             */
+static struct move decode_move(const struct position *pos, unsigned int data) {
+	int to_square = data & 63;
+	int from_square = data >> 6 & 63;
+	int promotion_type = data >> 12 & 7;
+
+	if (pos->board[from_square] == PIECE(pos->side_to_move, KING)) {
+		if (pos->board[to_square] == PIECE(pos->side_to_move, ROOK)) {
+			int file = FILE(to_square) == FILE_H ? FILE_G : FILE_C;
+
+			to_square = SQUARE(file, RANK(to_square));
+		}
+	}
+
+	/* the promotion types 1 to 4 match `KNIGHT` to `QUEEN`.                 */
+	return make_move(from_square, to_square, promotion_type ? promotion_type : NO_TYPE);
+}
+
+unsigned int book_encode_move(const struct position *pos, struct move move) {
+	int to_square = move.to_square;
+	int promotion_type = move.promotion_type == NO_TYPE ? 0 : move.promotion_type;
+
+	if (pos->board[move.from_square] == PIECE(pos->side_to_move, KING)) {
+		if (FILE(move.from_square) == FILE_E && FILE(to_square) == FILE_G) {
+			to_square = SQUARE(FILE_H, RANK(to_square));
+		} else if (FILE(move.from_square) == FILE_E && FILE(to_square) == FILE_C) {
+			to_square = SQUARE(FILE_A, RANK(to_square));
+		}
+	}
+
+	return (unsigned int)(promotion_type << 12 | move.from_square << 6 | to_square);
+}
+
+/* returns true if the move is one of the `count` moves in `moves`.          */
+static int contains_move(const struct move *moves, size_t count, struct move move) {
+	size_t index;
+
+	for (index = 0; index < count; index++) {
+		if (moves[index].from_square == move.from_square &&
+		    moves[index].to_square == move.to_square &&
+		    moves[index].promotion_type == move.promotion_type) {
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+int book_open(struct book *book, const char *path) {
+	struct stat st;
+	void *data;
+	int fd;
+
+	book_close(book);
+
+	fd = open(path, O_RDONLY);
+
+	if (fd < 0) {
+		return FAILURE;
+	}
+
+	if (fstat(fd, &st) != 0 || st.st_size < ENTRY_SIZE || st.st_size % ENTRY_SIZE != 0) {
+		close(fd);
+
+		return FAILURE;
+	}
+
+	/* the mapping stays valid after the file is closed.                     */
+	data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+
+	if (data == MAP_FAILED) {
+		return FAILURE;
+	}
+
+	book->data = data;
+	book->count = st.st_size / ENTRY_SIZE;
+
+	return SUCCESS;
+}
+
+void book_close(struct book *book) {
+	if (book->data) {
+		munmap((void *)book->data, book->count * ENTRY_SIZE);
+	}
+
+	book->data = NULL;
+	book->count = 0;
+}
+
+int book_probe(const struct book *book, const struct position *pos, struct move *move) {
+	struct move moves[MAX_MOVES];
+	size_t count;
+	size_t low = 0;
+	size_t high = book->count;
+	size_t index;
+	unsigned long total = 0;
+	unsigned long pick;
+
+	if (!book->data) {
+		return FAILURE;
+	}
+
+	/* binary search for the first entry with the key of the position.       */
+	while (low < high) {
+		size_t middle = low + (high - low) / 2;
+
+		if (entry_key(book, middle) < pos->key) {
+			low = middle + 1;
+		} else {
+			high = middle;
+		}
+	}
+
+	if (low == book->count || entry_key(book, low) != pos->key) {
+		return FAILURE;
+	}
+
+	/* sum the weights of all legal moves for the position. checking the     */
+	/* moves also protects us against the occasional key collision.          */
+	count = generate_legal_moves(pos, moves);
+
+	for (index = low; index < book->count && entry_key(book, index) == pos->key; index++) {
+		if (contains_move(moves, count, decode_move(pos, entry_move(book, index)))) {
+			total += entry_weight(book, index);
+		}
+	}
+
+	if (total == 0) {
+		return FAILURE;
+	}
+
+	/* pick a move at random in proportion to its weight.                    */
+	pick = (unsigned long)rand() % total;
+
+	for (index = low; index < book->count && entry_key(book, index) == pos->key; index++) {
+		*move = decode_move(pos, entry_move(book, index));
+
+		if (contains_move(moves, count, *move)) {
+			unsigned long weight = entry_weight(book, index);
+
+			if (pick < weight) {
+				return SUCCESS;
+			}
+
+			pick -= weight;
+		}
+	}
+
+	return FAILURE;
+}
@@ -0,0 +1,726 @@
+#define _POSIX_C_SOURCE 200112L
+
+#include "bookgen.h"
+#include "book.h"
+#include "move.h"
+#include "position.h"
+#include "types.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define START_FEN "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1"
+
+/* game results, from the perspective of white.                              */
+#define RESULT_UNKNOWN -1
+#define RESULT_LOSS 0
+#define RESULT_DRAW 1
+#define RESULT_WIN 2
+
+#define TOKEN_END 0
+#define TOKEN_TAG 1
+#define TOKEN_MOVE 2
+#define TOKEN_RESULT 3
+
+/* the number of times a move was played in a position, and how the games   */
+/* ended for the side that played it. entries with `games` set to zero are   */
+/* empty.                                                                    */
+struct entry {
+	uint64_t key;
+	uint32_t games;
+	uint32_t wins;
+	uint32_t draws;
+	unsigned int move;
+};
+
+/* an open addressing hash table of entries, using linear probing.          */
+struct table {
+	struct entry *entries;
+	size_t capacity;
+	size_t count;
+
+	/* entries with at most this many games are dropped when pruning.        */
+	uint32_t threshold;
+	size_t dropped;
+};
+
+/* a move played in a game, waiting for the result of the game.             */
+struct ply {
+	uint64_t key;
+	unsigned int move;
+	int color;
+};
+
+/* a buffered reader for PGN files, with room to push back one token.        */
+struct reader {
+	FILE *stream;
+	size_t length;
+	size_t index;
+	char buffer[65536];
+	int pushed_type;
+	char pushed[256];
+};
+
+struct bookgen {
+	const char *output;
+	int max_ply;
+	uint32_t min_games;
+	int thread_count;
+	size_t memory;
+
+	char **files;
+	int file_count;
+
+	/* everything below is shared between threads and protected by `mutex`. */
+	pthread_mutex_t mutex;
+	int next_file;
+	struct table table;
+	unsigned long games;
+	unsigned long skipped;
+	unsigned long errors;
+};
+
+static size_t entry_index(const struct table *table, uint64_t key, unsigned int move) {
+	return (size_t)((key ^ move * UINT64_C(0x9E3779B97F4A7C15)) & (table->capacity - 1));
+}
+
+/* remove the entry at `index`, shifting back later entries of the same      */
+/* cluster so that lookups keep working without tombstones.                  */
+static void remove_entry(struct table *table, size_t index) {
+	size_t mask = table->capacity - 1;
+	size_t next = index;
+
+	for (;;) {
+		size_t home;
+
+		next = (next + 1) & mask;
+
+		if (table->entries[next].games == 0) {
+			break;
+		}
+
+		/* an entry may only move back if that keeps it between its home     */
+		/* slot and its current slot.                                        */
+		home = entry_index(table, table->entries[next].key, table->entries[next].move);
+
+		if (index <= next ? index < home && home <= next : index < home || home <= next) {
+			continue;
+		}
+
+		table->entries[index] = table->entries[next];
+		index = next;
+	}
+
+	table->entries[index].games = 0;
+	table->count--;
+}
+
+/* drop the entries with the fewest games until the table is half full.     */
+static void prune_table(struct table *table) {
+	while (table->count > table->capacity / 2) {
+		size_t index = 0;
+
+		table->threshold++;
+
+		while (index < table->capacity) {
+			struct entry *entry = &table->entries[index];
+
+			/* removing an entry may move another one into its slot, so we   */
+			/* only advance when the current slot is kept.                   */
+			if (entry->games != 0 && entry->games <= table->threshold) {
+				remove_entry(table, index);
+				table->dropped++;
+			} else {
+				index++;
+			}
+		}
+	}
+}
+
+static void add_move(struct table *table, const struct ply *ply, int result) {
+	size_t index = entry_index(table, ply->key, ply->move);
+	struct entry *entry;
+
+	for (;;) {
+		entry = &table->entries[index];
+
+		if (entry->games == 0 || (entry->key == ply->key && entry->move == ply->move)) {
+			break;
+		}
+
+		index = (index + 1) & (table->capacity - 1);
+	}
+
+	if (entry->games == 0) {
+		entry->key = ply->key;
+		entry->move = ply->move;
+		entry->wins = 0;
+		entry->draws = 0;
+		table->count++;
+	}
+
+	entry->games++;
+
+	if (result == RESULT_DRAW) {
+		entry->draws++;
+	} else if (result == (ply->color == WHITE ? RESULT_WIN : RESULT_LOSS)) {
+		entry->wins++;
+	}
+
+	if (table->count > table->capacity / 4 * 3) {
+		prune_table(table);
+	}
+}
+
+static int next_char(struct reader *reader) {
+	if (reader->index == reader->length) {
+		reader->length = fread(reader->buffer, 1, sizeof reader->buffer, reader->stream);
+		reader->index = 0;
+
+		if (reader->length == 0) {
+			return EOF;
+		}
+	}
+
+	return (unsigned char)reader->buffer[reader->index++];
+}
+
+/* skip characters up to and including `end`.                                */
+static void skip_until(struct reader *reader, int end) {
+	int c;
+
+	while ((c = next_char(reader)) != EOF && c != end) {
+	}
+}
+
+/* read the next tag, move, or result into `token`, skipping comments,       */
+/* variations, move numbers, and annotations. tags are returned without the  */
+/* surrounding brackets. returns the type of the token.                      */
+static int read_token(struct reader *reader, char *token, size_t size) {
+	if (reader->pushed_type != TOKEN_END) {
+		int type = reader->pushed_type;
+
+		strcpy(token, reader->pushed);
+		reader->pushed_type = TOKEN_END;
+
+		return type;
+	}
+
+	for (;;) {
+		int c = next_char(reader);
+		size_t length = 0;
+		char *start;
+
+		switch (c) {
+		case EOF:
+			return TOKEN_END;
+
+		case '[':
+			/* tags may contain spaces and brackets inside their value.      */
+			while ((c = next_char(reader)) != EOF && c != ']') {
+				if (c == '"') {
+					do {
+						if (length + 1 < size) {
+							token[length++] = (char)c;
+						}
+
+						c = next_char(reader);
+
+						if (c == '\\') {
+							c = next_char(reader);
+						}
+					} while (c != EOF && c != '"');
+
+					if (c == EOF) {
+						break;
+					}
+				}
+
+				if (length + 1 < size) {
+					token[length++] = (char)c;
+				}
+			}
+
+			token[length] = '\0';
+
+			return TOKEN_TAG;
+
+		case '{':
+			skip_until(reader, '}');
+			continue;
+
+		case ';':
+		case '%':
+			skip_until(reader, '\n');
+			continue;
+
+		case '(': {
+			int depth = 1;
+
+			while (depth > 0 && (c = next_char(reader)) != EOF) {
+				if (c == '{') {
+					skip_until(reader, '}');
+				} else if (c == '(') {
+					depth++;
+				} else if (c == ')') {
+					depth--;
+				}
+			}
+
+			continue;
+		}
+
+		case ' ':
+		case '\t':
+		case '\r':
+		case '\n':
+		case ')':
+		case ']':
+		case '}':
+			continue;
+		}
+
+		/* read a symbol up to the next space or special character.          */
+		while (c != EOF && !strchr(" \t\r\n[]{}();%", c)) {
+			if (length + 1 < size) {
+				token[length++] = (char)c;
+			}
+
+			c = next_char(reader);
+		}
+
+		token[length] = '\0';
+
+		/* the character that ended the symbol may start the next token.     */
+		if (c != EOF) {
+			reader->index--;
+		}
+
+		if (token[0] == '$') {
+			continue;
+		}
+
+		if (!strcmp(token, "1-0") || !strcmp(token, "0-1") || !strcmp(token, "1/2-1/2") || !strcmp(token, "*")) {
+			return TOKEN_RESULT;
+		}
+
+		/* strip move numbers, which may be attached to the move.            */
+		start = token;
+
+		if (strncmp(token, "0-0", 3) != 0) {
+			while (*start >= '0' && *start <= '9') {
+				start++;
+			}
+
+			if (*start == '.') {
+				while (*start == '.') {
+					start++;
+				}
+			} else {
+				start = token;
+			}
+		}
+
+		if (*start) {
+			memmove(token, start, strlen(start) + 1);
+
+			return TOKEN_MOVE;
+		}
+	}
+}
+
+static void push_token(struct reader *reader, int type, const char *token) {
+	reader->pushed_type = type;
+	strncpy(reader->pushed, token, sizeof reader->pushed - 1);
+	reader->pushed[sizeof reader->pushed - 1] = '\0';
+}
+
+static int parse_result(const char *string) {
+	if (!strcmp(string, "1-0")) {
+		return RESULT_WIN;
+	} else if (!strcmp(string, "0-1")) {
+		return RESULT_LOSS;
+	} else if (!strcmp(string, "1/2-1/2")) {
+		return RESULT_DRAW;
+	} else {
+		return RESULT_UNKNOWN;
+	}
+}
+
+/* split a tag of the form `Name "value"` into its name and value, in place. */
+/* returns the value, or `NULL` if the tag is malformed.                     */
+static char *split_tag(char *tag) {
+	char *value = strchr(tag, '"');
+	char *end;
+
+	if (!value) {
+		return NULL;
+	}
+
+	*value++ = '\0';
+	end = strrchr(value, '"');
+
+	if (end) {
+		*end = '\0';
+	}
+
+	/* remove the spaces between the name and the value.                     */
+	end = value - 1;
+
+	while (end > tag && (end[-1] == ' ' || end[-1] == '\t')) {
+		*--end = '\0';
+	}
+
+	return value;
+}
+
+/* read the next game, storing its first `max_ply` moves in `plies`. returns */
+/* the number of plies stored, or -1 if there are no more games.             */
+static int read_game(struct bookgen *gen, struct reader *reader, struct ply *plies, int *result, int *error) {
+	struct position pos;
+	char token[256];
+	int count = 0;
+	int started = 0;
+	int movetext = 0;
+	int tag_result = RESULT_UNKNOWN;
+	int type;
+
+	parse_position(&pos, START_FEN);
+	*result = RESULT_UNKNOWN;
+	*error = 0;
+
+	while ((type = read_token(reader, token, sizeof token)) != TOKEN_END) {
+		if (type == TOKEN_TAG) {
+			char *value;
+
+			/* a tag after the moves starts the next game, the current game  */
+			/* is missing its result.                                        */
+			if (movetext) {
+				push_token(reader, type, token);
+
+				break;
+			}
+
+			started = 1;
+			value = split_tag(token);
+
+			if (!value) {
+				continue;
+			}
+
+			if (!strcmp(token, "Result")) {
+				tag_result = parse_result(value);
+			} else if (!strcmp(token, "FEN")) {
+				if (parse_position(&pos, value) != SUCCESS) {
+					*error = 1;
+				}
+			}
+		} else if (type == TOKEN_MOVE) {
+			struct move move;
+
+			started = 1;
+			movetext = 1;
+
+			/* stop parsing moves once we have enough, or after an error.    */
+			if (count >= gen->max_ply || *error) {
+				continue;
+			}
+
+			if (parse_san(&move, &pos, token) != SUCCESS) {
+				*error = 1;
+
+				continue;
+			}
+
+			plies[count].key = pos.key;
+			plies[count].move = book_encode_move(&pos, move);
+			plies[count].color = pos.side_to_move;
+			count++;
+
+			do_move(&pos, move);
+		} else {
+			*result = tag_result != RESULT_UNKNOWN ? tag_result : parse_result(token);
+
+			return count;
+		}
+	}
+
+	if (!started) {
+		return -1;
+	}
+
+	*result = tag_result;
+
+	return count;
+}
+
+static void *bookgen_worker(void *arg) {
+	struct bookgen *gen = arg;
+	struct reader *reader = malloc(sizeof *reader);
+	struct ply *plies = malloc(gen->max_ply * sizeof *plies);
+
+	if (!reader || !plies) {
+		fprintf(stderr, "bookgen: out of memory\n");
+		free(reader);
+		free(plies);
+
+		return NULL;
+	}
+
+	for (;;) {
+		int file;
+		int count;
+		int result;
+		int error;
+
+		pthread_mutex_lock(&gen->mutex);
+		file = gen->next_file++;
+		pthread_mutex_unlock(&gen->mutex);
+
+		if (file >= gen->file_count) {
+			break;
+		}
+
+		reader->stream = fopen(gen->files[file], "r");
+		reader->length = 0;
+		reader->index = 0;
+		reader->pushed_type = TOKEN_END;
+
+		if (!reader->stream) {
+			fprintf(stderr, "bookgen: could not open %s\n", gen->files[file]);
+
+			continue;
+		}
+
+		while ((count = read_game(gen, reader, plies, &result, &error)) >= 0) {
+			int index;
+
+			pthread_mutex_lock(&gen->mutex);
+
+			if (error) {
+				gen->errors++;
+			}
+
+			if (result == RESULT_UNKNOWN) {
+				gen->skipped++;
+			} else {
+				gen->games++;
+
+				for (index = 0; index < count; index++) {
+					add_move(&gen->table, &plies[index], result);
+				}
+			}
+
+			pthread_mutex_unlock(&gen->mutex);
+		}
+
+		fclose(reader->stream);
+	}
+
+	free(reader);
+	free(plies);
+
+	return NULL;
+}
+
+static void put_number(unsigned char *data, uint64_t number, int size) {
+	while (size-- > 0) {
+		data[size] = (unsigned char)(number & 255);
+		number >>= 8;
+	}
+}
+
+static int compare_entries(const void *a, const void *b) {
+	const struct entry *x = a;
+	const struct entry *y = b;
+
+	if (x->key != y->key) {
+		return x->key < y->key ? -1 : 1;
+	}
+
+	/* within a position, list the heaviest moves first.                     */
+	return x->wins < y->wins ? 1 : x->wins > y->wins ? -1 : 0;
+}
+
+/* write the book, reusing the `wins` field of every entry for its weight.   */
+static int write_book(struct bookgen *gen, size_t *written) {
+	struct table *table = &gen->table;
+	uint32_t max_weight = 0;
+	size_t count = 0;
+	size_t index;
+	FILE *stream;
+
+	/* move the entries we keep to the front and compute their weights.      */
+	for (index = 0; index < table->capacity; index++) {
+		struct entry entry = table->entries[index];
+
+		if (entry.games == 0 || entry.games < gen->min_games) {
+			continue;
+		}
+
+		entry.wins = 2 * entry.wins + entry.draws;
+
+		if (entry.wins == 0) {
+			continue;
+		}
+
+		if (entry.wins > max_weight) {
+			max_weight = entry.wins;
+		}
+
+		table->entries[count++] = entry;
+	}
+
+	/* scale the weights down if they do not fit in 16 bits.                 */
+	if (max_weight > 65535) {
+		for (index = 0; index < count; index++) {
+			uint64_t weight = (uint64_t)table->entries[index].wins * 65535 / max_weight;
+
+			table->entries[index].wins = weight > 0 ? (uint32_t)weight : 1;
+		}
+	}
+
+	qsort(table->entries, count, sizeof *table->entries, compare_entries);
+
+	stream = fopen(gen->output, "wb");
+
+	if (!stream) {
+		return FAILURE;
+	}
+
+	for (index = 0; index < count; index++) {
+		unsigned char data[16];
+
+		put_number(data, table->entries[index].key, 8);
+		put_number(data + 8, table->entries[index].move, 2);
+		put_number(data + 10, table->entries[index].wins, 2);
+		put_number(data + 12, 0, 4);
+
+		if (fwrite(data, sizeof data, 1, stream) != 1) {
+			fclose(stream);
+
+			return FAILURE;
+		}
+	}
+
+	*written = count;
+
+	return fclose(stream) == 0 ? SUCCESS : FAILURE;
+}
+
+static int parse_options(struct bookgen *gen, int argc, char **argv) {
+	int index;
+
+	gen->output = "book.bin";
+	gen->max_ply = 24;
+	gen->min_games = 1;
+	gen->thread_count = (int)sysconf(_SC_NPROCESSORS_ONLN);
+	gen->memory = 256;
+
+	for (index = 0; index < argc && argv[index][0] == '-'; index += 2) {
+		const char *option = argv[index];
+		const char *value = index + 1 < argc ? argv[index + 1] : NULL;
+
+		if (!value) {
+			return FAILURE;
+		} else if (!strcmp(option, "-o")) {
+			gen->output = value;
+		} else if (!strcmp(option, "-ply")) {
+			gen->max_ply = atoi(value);
+		} else if (!strcmp(option, "-min")) {
+			gen->min_games = (uint32_t)atol(value);
+		} else if (!strcmp(option, "-threads")) {
+			gen->thread_count = atoi(value);
+		} else if (!strcmp(option, "-memory")) {
+			gen->memory = (size_t)atol(value);
+		} else {
+			return FAILURE;
+		}
+	}
+
+	gen->files = argv + index;
+	gen->file_count = argc - index;
+
+	if (gen->file_count == 0 || gen->max_ply <= 0 || gen->memory == 0) {
+		return FAILURE;
+	}
+
+	if (gen->thread_count < 1) {
+		gen->thread_count = 1;
+	}
+
+	if (gen->thread_count > gen->file_count) {
+		gen->thread_count = gen->file_count;
+	}
+
+	return SUCCESS;
+}
+
+int bookgen_run(int argc, char **argv) {
+	struct bookgen gen;
+	pthread_t *threads;
+	size_t written = 0;
+	int index;
+
+	if (parse_options(&gen, argc, argv) != SUCCESS) {
+		fprintf(stderr, "usage: bookgen [-o path] [-ply n] [-min n] [-threads n] [-memory n] file.pgn ...\n");
+
+		return FAILURE;
+	}
+
+	/* use the largest power of two number of entries that fits.             */
+	gen.table.capacity = 1024;
+
+	while (gen.table.capacity * 2 * sizeof(struct entry) <= gen.memory * 1024 * 1024) {
+		gen.table.capacity *= 2;
+	}
+
+	gen.table.entries = calloc(gen.table.capacity, sizeof *gen.table.entries);
+	gen.table.count = 0;
+	gen.table.threshold = 0;
+	gen.table.dropped = 0;
+	threads = malloc(gen.thread_count * sizeof *threads);
+
+	if (!gen.table.entries || !threads) {
+		fprintf(stderr, "bookgen: out of memory\n");
+		free(gen.table.entries);
+		free(threads);
+
+		return FAILURE;
+	}
+
+	pthread_mutex_init(&gen.mutex, NULL);
+	gen.next_file = 0;
+	gen.games = 0;
+	gen.skipped = 0;
+	gen.errors = 0;
+
+	for (index = 0; index < gen.thread_count; index++) {
+		pthread_create(&threads[index], NULL, bookgen_worker, &gen);
+	}
+
+	for (index = 0; index < gen.thread_count; index++) {
+		pthread_join(threads[index], NULL);
+	}
+
+	fprintf(stderr, "%lu games, %lu without result, %lu with errors\n", gen.games, gen.skipped, gen.errors);
+
+	if (gen.table.dropped > 0) {
+		fprintf(stderr, "%lu rare moves dropped, at most %lu games each\n", (unsigned long)gen.table.dropped, (unsigned long)gen.table.threshold);
+	}
+
+	if (write_book(&gen, &written) != SUCCESS) {
+		fprintf(stderr, "bookgen: could not write %s\n", gen.output);
+	} else {
+		fprintf(stderr, "%lu entries written to %s\n", (unsigned long)written, gen.output);
+	}
+
+	pthread_mutex_destroy(&gen.mutex);
+	free(gen.table.entries);
+	free(threads);
+
+	return written > 0 ? SUCCESS : FAILURE;
+}
@@ -0,0 +1,109 @@
+#include "cpu.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if CPU_DISPATCH
+#include <cpuid.h>
+#endif
+
+static const char *feature_names[] = { "popcnt", "bmi2", "avx2" };
+
+static pthread_once_t features_once = PTHREAD_ONCE_INIT;
+static int features;
+static char description[32];
+
+#if CPU_DISPATCH
+/* returns non-zero if the operating system saves the avx registers on a     */
+/* context switch, without which avx instructions fault even when the        */
+/* processor has them.                                                       */
+static int avx_enabled(void) {
+	unsigned int eax;
+	unsigned int edx;
+
+	__asm__("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+
+	return (eax & 6) == 6;
+}
+
+static int detect_features(void) {
+	unsigned int eax, ebx, ecx, edx;
+	unsigned int max_leaf = __get_cpuid_max(0, NULL);
+	unsigned int family;
+	int amd;
+	int result = 0;
+
+	if (max_leaf < 1) {
+		return 0;
+	}
+
+	__cpuid(0, eax, ebx, ecx, edx);
+	amd = ebx == 0x68747541 && edx == 0x69746E65 && ecx == 0x444D4163;
+
+	__cpuid(1, eax, ebx, ecx, edx);
+	family = (eax >> 8 & 0xF) == 0xF ? 0xF + (eax >> 20 & 0xFF) : eax >> 8 & 0xF;
+
+	if (ecx >> 23 & 1) {
+		result |= CPU_POPCNT;
+	}
+
+	if (max_leaf >= 7) {
+		int osxsave = ecx >> 27 & 1;
+
+		__cpuid_count(7, 0, eax, ebx, ecx, edx);
+
+		/* zen 3 is family 0x19.                                             */
+		if ((ebx >> 8 & 1) && !(amd && family < 0x19)) {
+			result |= CPU_BMI2;
+		}
+
+		if ((ebx >> 5 & 1) && osxsave && avx_enabled()) {
+			result |= CPU_AVX2;
+		}
+	}
+
+	return result;
+}
+#else
+static int detect_features(void) {
+	return 0;
+}
+#endif
+
+static void init_features(void) {
+	const char *allowed = getenv("CHESSBOT_CPU");
+	size_t index;
+
+	features = detect_features();
+
+	for (index = 0; index < sizeof feature_names / sizeof *feature_names; index++) {
+		if (allowed && !strstr(allowed, feature_names[index])) {
+			features &= ~(1 << index);
+		}
+
+		if (features & 1 << index) {
+			if (*description) {
+				strcat(description, " ");
+			}
+
+			strcat(description, feature_names[index]);
+		}
+	}
+
+	if (!*description) {
+		strcpy(description, "generic");
+	}
+}
+
+int cpu_features(void) {
+	pthread_once(&features_once, init_features);
+
+	return features;
+}
+
+const char *cpu_description(void) {
+	pthread_once(&features_once, init_features);
+
+	return description;
+}
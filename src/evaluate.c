@@ -1,7 +1,28 @@
 #include "evaluate.h"
+#include "cpu.h"
 #include "types.h"
 #include "generate.h"
-#include <stdbool.h>
+#include "profile.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/* the evaluation is compiled for several instruction sets, and the best     */
+/* one the processor has is picked when the tables are initialized, see      */
+/* `cpu.h`. set `EVALUATE_CHECK` to 1 to compare the avx2 material and piece */
+/* square sum with the scalar one on every evaluation.                       */
+#ifndef EVALUATE_CHECK
+#define EVALUATE_CHECK 0
+#endif
+
+#if CPU_DISPATCH
+#include <immintrin.h>
+#endif
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 static const int piece_value[6] = { 100, 300, 300, 500, 900, 1000000 };
 
@@ -54,126 +75,173 @@ static const int bishop_table[64] = {-20, -10, -10, -10, -10, -10, -10, -20,
 									-10,   0,   0,   0,   0,   0,   0, -10,
 									-20, -10, -10, -10, -10, -10, -10, -20};
 
-int mirror(int square) {
-    int rank = square / 8;
-    int file = square % 8;
-    return (7 - rank) * 8 + file;
+/* white uses the tables above as they are, black mirrors them vertically.   */
+static int mirror(int square) {
+	return SQUARE(FILE(square), 7 - RANK(square));
 }
 
-int	psq_calc(int piece, int square)
-{
-	switch (piece)
-	{
-		case PAWN:  
-			return pawn_table[square];
-		case KNIGHT: 
-			return knight_table[square];
-		case BISHOP: 
-			return bishop_table[square];
-		case ROOK: 
-			return rook_table[square];
-		case QUEEN: 
-			return queen_table[square];
-		case KING: 
-			return king_table[square];
-		default:
-			return 0;
-	}
-}
+static const int *const psq_tables[6] = { pawn_table, knight_table, bishop_table, rook_table, queen_table, king_table };
 
-int is_pawn_connected(const struct position *pos, int square, int color) {
-   
-    int file = square % 8;
-	int mult = 1;
-
-    if (file > 0) {
-        int left_diagonal; /* -9 for white, +7 for black*/
-		if (color == WHITE)
-		{
-			left_diagonal = square - 9;
-			if (pos->board[left_diagonal] == WHITE)
-				return 10;
-			mult = -1;
-		}	
-		else if (color == BLACK)
-		{
-			left_diagonal = square + 7;
-			if (pos->board[left_diagonal] == BLACK)
-				return -10;
-		}
-    }
-    if (file < 7) {
-        int right_diagonal;  /* -7 for white, +9 for black */
-		if (color == WHITE)
-		{
-			right_diagonal = square - 7;
-			if (pos->board[right_diagonal] == WHITE)
-				return 10;
-			mult = -1;
-		}
-		else if (color == BLACK )
-		{
-			right_diagonal = square + 9;
-			if (pos->board[right_diagonal] == BLACK)
-				return -10;
-		}
-    }
-    return 15 * mult;
-}
+/* material and piece square values for every board entry and square, from   */
+/* white's point of view and already mirrored for black. the first row is    */
+/* for empty squares, so the table is indexed with `pos->board[square] + 1`. */
+static int psq_board[13][64];
+static pthread_once_t init_once = PTHREAD_ONCE_INIT;
+
+/* the evaluation kernel picked by `init_evaluation`.                        */
+static int (*evaluate_kernel)(const struct position *pos);
 
-int	pawn_doubled_or_isolated(const struct position *pos, int color)
-{
-	int pawn_count[8] = {0};
+static void init_psq(void) {
+	int piece;
 	int square;
-	int score = 0;
-	int file;
-	int check_left;
-	int check_right;
-
-	for (square = 0; square < 64; square++) {
-		if (pos->board[square] == PAWN && COLOR(pos->board[square]) == color) {
-			file = FILE(square);
-			pawn_count[file]++;
+
+	for (piece = 0; piece < 12; piece++) {
+		for (square = 0; square < 64; square++) {
+			int type = TYPE(piece);
+
+			if (COLOR(piece) == WHITE) {
+				psq_board[piece + 1][square] = piece_value[type] + psq_tables[type][square];
+			} else {
+				psq_board[piece + 1][square] = -piece_value[type] - psq_tables[type][mirror(square)];
+			}
 		}
 	}
-	for (file = 0; file < 8; file++) {
-		if (pawn_count[file] > 1)
-			score -= 10 * (pawn_count[file] - 1);
+}
 
-		if (pawn_count[file] > 0) {
-			check_left  = (file > 0) ? (pawn_count[file - 1] > 0) : 0;
-			check_right = (file < 7) ? (pawn_count[file + 1] > 0) : 0;
+/* sum the material and piece square values by walking the piece lists.      */
+static int psq_scalar(const struct position *pos) {
+	int score = 0;
+	int color;
+	int index;
+
+	for (color = WHITE; color <= BLACK; color++) {
+		for (index = 0; index < pos->piece_count[color]; index++) {
+			int square = pos->pieces[color][index];
 
-			if (!check_left && !check_right)
-				score -= 15;
+			score += psq_board[pos->board[square] + 1][square];
 		}
 	}
+
 	return score;
 }
 
-int evaluate(const struct position *pos) {
-	int score[2] = { 0, 0 };
-    int square;
-	int piece; 
-	int piece_val;
-	int psq_val;
-    
-	for (square = 0; square < 64; square++) {
-		piece = pos->board[square];
-		if (piece == NO_PIECE)
-			continue;
-		piece_val = piece_value[TYPE(piece)];
-		if (COLOR(piece) == 0) {
-			psq_val = psq_calc(TYPE(piece), square);
-			score[WHITE] += piece_val + psq_val;
-		} else {
-			psq_val = psq_calc(TYPE(piece), mirror(square));
-			score[BLACK] += piece_val + psq_val;
+#if CPU_DISPATCH
+/* gather the values of 8 squares at a time, with the board entry and the    */
+/* square as the index into the table.                                       */
+static __attribute__((target("avx2"))) int psq_avx2(const struct position *pos) {
+	__m256i squares = _mm256_setr_epi32(64, 65, 66, 67, 68, 69, 70, 71);
+	__m256i sum = _mm256_setzero_si256();
+	__m128i half;
+	int index;
+
+	for (index = 0; index < 64; index += 8) {
+		__m256i pieces = _mm256_cvtepi8_epi32(_mm_loadl_epi64((const __m128i *)(pos->board + index)));
+		__m256i offsets = _mm256_add_epi32(_mm256_slli_epi32(pieces, 6), squares);
+
+		sum = _mm256_add_epi32(sum, _mm256_i32gather_epi32(&psq_board[0][0], offsets, 4));
+		squares = _mm256_add_epi32(squares, _mm256_set1_epi32(8));
+	}
+
+	half = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+	half = _mm_add_epi32(half, _mm_shuffle_epi32(half, 0x4E));
+	half = _mm_add_epi32(half, _mm_shuffle_epi32(half, 0xB1));
+
+	/* the compiler does not clear the upper halves of the registers for a   */
+	/* function with a target attribute, and until they are cleared every    */
+	/* sse instruction of the rest of the engine is slowed down.             */
+	_mm256_zeroupper();
+
+	return _mm_cvtsi128_si32(half);
+}
+#endif
+
+#define FILE_A_SQUARES UINT64_C(0x0101010101010101)
+#define FILE_H_SQUARES UINT64_C(0x8080808080808080)
+
+/* store the squares of the pawns of each color in `pawns`, one bit per      */
+/* square. with sse2 the board is compared with both pawns 16 squares at a   */
+/* time.                                                                     */
+static void find_pawns(const struct position *pos, uint64_t *pawns) {
+#if defined(__SSE2__)
+	__m128i white_pawn = _mm_set1_epi8(PIECE(WHITE, PAWN));
+	__m128i black_pawn = _mm_set1_epi8(PIECE(BLACK, PAWN));
+	int index;
+
+	pawns[WHITE] = 0;
+	pawns[BLACK] = 0;
+
+	for (index = 0; index < 64; index += 16) {
+		__m128i squares = _mm_loadu_si128((const __m128i *)(pos->board + index));
+
+		pawns[WHITE] |= (uint64_t)(unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(squares, white_pawn)) << index;
+		pawns[BLACK] |= (uint64_t)(unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(squares, black_pawn)) << index;
+	}
+#else
+	int color;
+	int index;
+
+	for (color = WHITE; color <= BLACK; color++) {
+		pawns[color] = 0;
+
+		for (index = 0; index < pos->piece_count[color]; index++) {
+			int square = pos->pieces[color][index];
+
+			if (pos->board[square] == PIECE(color, PAWN)) {
+				pawns[color] |= (uint64_t)1 << square;
+			}
 		}
 	}
-	if (pos->side_to_move == WHITE)
-		score[WHITE] += pawn_doubled_or_isolated(pos, WHITE) + is_pawn_connected(pos, square, WHITE);
-	if (pos->side_to_move == BLACK)
-		score[BLACK] = score[BLACK] - pawn_doubled_or_isolated(pos, BLACK) + is_pawn_connected(pos, square, BLACK);
-	return (score[pos->side_to_move] - score[1 - pos->side_to_move]);
+#endif
+}
+
+/* instantiate the evaluation once for every instruction set.                */
+#define SPECIALIZE(name) name##_generic
+#define TARGET
+#define KERNEL_AVX2 0
+#include "evaluate_kernel.h"
+#undef SPECIALIZE
+#undef TARGET
+#undef KERNEL_AVX2
+
+#if CPU_DISPATCH
+#define SPECIALIZE(name) name##_popcnt
+#define TARGET __attribute__((target("popcnt")))
+#define KERNEL_AVX2 0
+#include "evaluate_kernel.h"
+#undef SPECIALIZE
+#undef TARGET
+#undef KERNEL_AVX2
+
+#define SPECIALIZE(name) name##_avx2
+#define TARGET __attribute__((target("avx2,popcnt")))
+#define KERNEL_AVX2 1
+#include "evaluate_kernel.h"
+#undef SPECIALIZE
+#undef TARGET
+#undef KERNEL_AVX2
+#endif
+
+/* fill in the tables and pick the kernel for this processor.                */
+static void init_evaluation(void) {
+	init_psq();
+	evaluate_kernel = evaluate_position_generic;
+
+#if CPU_DISPATCH
+	if ((cpu_features() & (CPU_AVX2 | CPU_POPCNT)) == (CPU_AVX2 | CPU_POPCNT)) {
+		evaluate_kernel = evaluate_position_avx2;
+	} else if (cpu_features() & CPU_POPCNT) {
+		evaluate_kernel = evaluate_position_popcnt;
+	}
+#endif
+}
+
+int evaluate(const struct position *pos) {
+	int score;
+
+	PROFILE_BEGIN(PROFILE_EVALUATE);
+	pthread_once(&init_once, init_evaluation);
+	score = evaluate_kernel(pos);
+	PROFILE_END(PROFILE_EVALUATE);
+
+	return score;
 }
@@ -0,0 +1,71 @@
+/* the evaluation for one instruction set. this file is included by          */
+/* `evaluate.c` once for every set it has a kernel for, see `cpu.h`, with    */
+/* `SPECIALIZE(name)` adding a suffix to the function names, `TARGET` the    */
+/* attribute that lets the compiler use the instructions of the set, and     */
+/* `KERNEL_AVX2` 1 when the piece square sum can use avx2. with popcnt, the  */
+/* population counts compile to one instruction instead of a library call.   */
+
+static TARGET int SPECIALIZE(count_squares)(uint64_t squares) {
+#if defined(__GNUC__)
+	return __builtin_popcountll(squares);
+#else
+	int count = 0;
+
+	for (; squares; squares &= squares - 1) {
+		count++;
+	}
+
+	return count;
+#endif
+}
+
+/* returns the score of the pawn structure of the color: a bonus for every   */
+/* pawn that is defended by a pawn, a penalty for every extra pawn on a      */
+/* file, and a penalty for every file with pawns but no pawns on the files   */
+/* next to it. both colors are scored the same way, so a position and its    */
+/* mirror image with the colors swapped get the same evaluation.             */
+static TARGET int SPECIALIZE(pawn_structure)(uint64_t pawns, int color) {
+	uint64_t defended;
+	uint64_t files = pawns | pawns >> 32;
+	uint64_t isolated;
+
+	if (color == WHITE) {
+		defended = (pawns & ~FILE_A_SQUARES) << 7 | (pawns & ~FILE_H_SQUARES) << 9;
+	} else {
+		defended = (pawns & ~FILE_A_SQUARES) >> 9 | (pawns & ~FILE_H_SQUARES) >> 7;
+	}
+
+	/* fold the ranks onto the first one, to get one bit for every file.     */
+	files |= files >> 16;
+	files |= files >> 8;
+	files &= 0xFF;
+	isolated = files & ~(files << 1 | files >> 1);
+
+	return 10 * SPECIALIZE(count_squares)(pawns & defended) - 10 * (SPECIALIZE(count_squares)(pawns) - SPECIALIZE(count_squares)(files)) - 15 * SPECIALIZE(count_squares)(isolated);
+}
+
+/* evaluate the position once the tables are initialized. with               */
+/* `EVALUATE_CHECK` the avx2 sum is compared with the scalar sum on every    */
+/* call, which is slow but catches any mismatch.                             */
+static TARGET int SPECIALIZE(evaluate_position)(const struct position *pos) {
+	uint64_t pawns[2];
+	int score;
+
+#if KERNEL_AVX2
+	score = psq_avx2(pos);
+
+#if EVALUATE_CHECK
+	if (score != psq_scalar(pos)) {
+		fprintf(stderr, "psq mismatch: avx2 %d, scalar %d\n", score, psq_scalar(pos));
+		abort();
+	}
+#endif
+#else
+	score = psq_scalar(pos);
+#endif
+
+	find_pawns(pos, pawns);
+	score += SPECIALIZE(pawn_structure)(pawns[WHITE], WHITE) - SPECIALIZE(pawn_structure)(pawns[BLACK], BLACK);
+
+	return pos->side_to_move == WHITE ? score : -score;
+}
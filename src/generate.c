@@ -1,219 +1,392 @@
 #include "generate.h"
+#include "profile.h"
+#include "tables.h"
 #include "types.h"
 
-/* add the file and rank offset to the square. returns `NO_SQUARE` if the    */
-/* resulting square is off the board.                                        */
-static int add_offset(int square, int file_offset, int rank_offset) {
-	int file = FILE(square) + file_offset;
-	int rank = RANK(square) + rank_offset;
+/* instantiate the move generator once for each color.                       */
+#define US WHITE
+#define THEM BLACK
+#define SPECIALIZE(name) name##_white
+#include "generate_color.h"
+#undef US
+#undef THEM
+#undef SPECIALIZE
+
+#define US BLACK
+#define THEM WHITE
+#define SPECIALIZE(name) name##_black
+#include "generate_color.h"
+#undef US
+#undef THEM
+#undef SPECIALIZE
 
-	if (file >= 0 && file < 8 && rank >= 0 && rank < 8) {
-		return SQUARE(file, rank);
+size_t generate_pseudo_legal_moves(const struct position *pos, struct move *moves) {
+	size_t count;
+
+	PROFILE_BEGIN(PROFILE_GENERATE);
+
+	if (pos->side_to_move == WHITE) {
+		count = generate_pseudo_legal_moves_white(pos, moves);
 	} else {
-		return NO_SQUARE;
+		count = generate_pseudo_legal_moves_black(pos, moves);
 	}
+
+	PROFILE_END(PROFILE_GENERATE);
+
+	return count;
 }
 
-/* generate a pawn move, taking into account promotions. returns the number  */
-/* of moves generated.                                                       */
-static size_t generate_pawn_move(const struct position *pos, struct move *moves, int from_square, int to_square) {
+size_t generate_legal_moves(const struct position *pos, struct move *moves) {
+	size_t pseudo_legal_count = generate_pseudo_legal_moves(pos, moves);
+	size_t index;
 	size_t count = 0;
+	int color = pos->side_to_move;
+	uint64_t attacks = ATTACKS(pos, 1 - color);
+	uint64_t safe = 0;
+
+	/* when the king is not in check, the pieces that the opponent does not  */
+	/* attack can not be pinned, see `is_legal`, so their moves are legal    */
+	/* without looking for the king again for every move.                    */
+	for (index = 0; index < (size_t)pos->piece_count[color]; index++) {
+		int square = pos->pieces[color][index];
+
+		if (pos->board[square] == PIECE(color, KING)) {
+			safe = attacks >> square & 1 ? 0 : ~attacks & ~((uint64_t)1 << square);
+		}
+	}
 
-	if (RANK(to_square) == RELATIVE(RANK_8, pos->side_to_move)) {
-		moves[count++] = make_move(from_square, to_square, KNIGHT);
-		moves[count++] = make_move(from_square, to_square, BISHOP);
-		moves[count++] = make_move(from_square, to_square, ROOK);
-		moves[count++] = make_move(from_square, to_square, QUEEN);
-	} else {
-		moves[count++] = make_move(from_square, to_square, NO_TYPE);
+	for (index = 0; index < pseudo_legal_count; index++) {
+		struct move move = moves[index];
+		int en_passant = move.to_square == pos->en_passant_square && pos->board[move.from_square] == PIECE(color, PAWN);
+
+		if ((safe >> move.from_square & 1 && !en_passant) || is_legal(pos, move)) {
+			moves[count++] = move;
+		}
 	}
 
 	return count;
 }
 
-/* generate a pawn capture, taking into account promotions. this function    */
-/* makes sure that the destination square is on the board, and that it       */
-/* contains an opponent piece or is the en passant square. returns the       */
-/* number of moves generated.                                                */
-static size_t generate_pawn_capture(const struct position *pos, struct move *moves, int from_square, int file_offset, int rank_offset) {
-	int to_square = add_offset(from_square, file_offset, rank_offset);
+/* returns the square of the first piece found on the ray, or `NO_SQUARE` if */
+/* the ray runs off the board.                                               */
+static int first_square(const struct position *pos, const signed char *ray) {
+	while (*ray != NO_SQUARE && pos->board[*ray] == NO_PIECE) {
+		ray++;
+	}
+
+	return *ray;
+}
+
+/* returns the square of a piece in the list, which ends with -1, or         */
+/* `NO_SQUARE` if none of the squares holds the piece.                       */
+static int find_piece(const struct position *pos, const signed char *squares, int piece) {
+	while (*squares != NO_SQUARE && pos->board[*squares] != piece) {
+		squares++;
+	}
 
-	if (to_square != NO_SQUARE) {
-		int piece = pos->board[to_square];
-		int capture = piece != NO_PIECE && COLOR(piece) != pos->side_to_move;
+	return *squares;
+}
+
+int is_attacked(const struct position *pos, int square, int color) {
+	int direction;
+
+	/* pawns attack diagonally forward, so look diagonally backward.         */
+	if (find_piece(pos, pawn_captures[1 - color][square], PIECE(color, PAWN)) != NO_SQUARE) {
+		return 1;
+	}
+
+	if (find_piece(pos, knight_moves[square], PIECE(color, KNIGHT)) != NO_SQUARE) {
+		return 1;
+	}
 
-		if (capture || to_square == pos->en_passant_square) {
-			return generate_pawn_move(pos, moves, from_square, to_square);
+	if (find_piece(pos, king_moves[square], PIECE(color, KING)) != NO_SQUARE) {
+		return 1;
+	}
+
+	/* bishops and queens on the diagonals, rooks and queens on the files    */
+	/* and ranks. the diagonals are at indices 0, 2, 5 and 7.                */
+	for (direction = 0; direction < 8; direction++) {
+		int diagonal = direction == 0 || direction == 2 || direction == 5 || direction == 7;
+		int from_square = first_square(pos, rays[square][direction]);
+		int piece;
+
+		if (from_square == NO_SQUARE) {
+			continue;
+		}
+
+		piece = pos->board[from_square];
+
+		if (piece == PIECE(color, QUEEN) || piece == PIECE(color, diagonal ? BISHOP : ROOK)) {
+			return 1;
 		}
 	}
 
 	return 0;
 }
 
-/* generate a simple, non-sliding move. this function makes sure that the    */
-/* destination square is on the board, and that it is empty or contains an   */
-/* opponent piece. returns the number of moves generated.                    */
-static size_t generate_simple_move(const struct position *pos, struct move *moves, int from_square, int file_offset, int rank_offset) {
-	size_t count = 0;
-	int to_square = add_offset(from_square, file_offset, rank_offset);
+int least_valuable_attacker(const struct position *pos, int square, int color) {
+	int best_square = NO_SQUARE;
+	int best_type = KING;
+	int direction;
+	int from_square;
+
+	from_square = find_piece(pos, pawn_captures[1 - color][square], PIECE(color, PAWN));
+
+	if (from_square != NO_SQUARE) {
+		return from_square;
+	}
+
+	from_square = find_piece(pos, knight_moves[square], PIECE(color, KNIGHT));
 
-	if (to_square != NO_SQUARE) {
-		int piece = pos->board[to_square];
+	if (from_square != NO_SQUARE) {
+		return from_square;
+	}
 
-		if (piece == NO_PIECE || COLOR(piece) != pos->side_to_move) {
-			moves[count++] = make_move(from_square, to_square, NO_TYPE);
+	/* the diagonals are at indices 0, 2, 5 and 7.                           */
+	for (direction = 0; direction < 8; direction++) {
+		int diagonal = direction == 0 || direction == 2 || direction == 5 || direction == 7;
+		int piece;
+
+		from_square = first_square(pos, rays[square][direction]);
+
+		if (from_square == NO_SQUARE) {
+			continue;
+		}
+
+		piece = pos->board[from_square];
+
+		if (COLOR(piece) == color && TYPE(piece) < best_type && (TYPE(piece) == QUEEN || TYPE(piece) == (diagonal ? BISHOP : ROOK))) {
+			best_square = from_square;
+			best_type = TYPE(piece);
 		}
 	}
 
-	return count;
+	if (best_square != NO_SQUARE) {
+		return best_square;
+	}
+
+	return find_piece(pos, king_moves[square], PIECE(color, KING));
 }
 
-/* generate a sliding move. this function keeps adding the offset in a loop  */
-/* until the destination square runs off the board or into another piece.    */
-/* returns the number of moves generated.                                    */
-static size_t generate_sliding_move(const struct position *pos, struct move *moves, int from_square, int file_offset, int rank_offset) {
-	size_t count = 0;
-	int to_square = add_offset(from_square, file_offset, rank_offset);
+/* returns the square of the king of the color, or `NO_SQUARE` if it has     */
+/* none.                                                                     */
+static int king_square(const struct position *pos, int color) {
+	int index;
 
-	while (to_square != NO_SQUARE) {
-		int piece = pos->board[to_square];
+	for (index = 0; index < pos->piece_count[color]; index++) {
+		int square = pos->pieces[color][index];
 
-		if (piece == NO_PIECE || COLOR(piece) != pos->side_to_move) {
-			moves[count++] = make_move(from_square, to_square, NO_TYPE);
+		if (pos->board[square] == PIECE(color, KING)) {
+			return square;
 		}
+	}
 
-		if (piece != NO_PIECE) {
-			break;
+	return NO_SQUARE;
+}
+
+int in_check(const struct position *pos) {
+	int color = pos->side_to_move;
+	int king = king_square(pos, color);
+
+	return king != NO_SQUARE && ATTACKED_BY(pos, king, 1 - color);
+}
+
+/* returns true if the first piece on the ray from the square in the         */
+/* direction is a slider of the color that moves along it. the occupied      */
+/* squares may differ from the board, for a move that was not made yet: a    */
+/* square that is occupied but empty on the board blocks the ray.            */
+static int slider_behind(const struct position *pos, uint64_t occupied, int square, int direction, int color) {
+	uint64_t blocker = ray_attacks(occupied, square, direction) & occupied;
+	int diagonal = direction == 0 || direction == 2 || direction == 5 || direction == 7;
+	int piece;
+
+	if (!blocker) {
+		return 0;
+	}
+
+	piece = pos->board[lowest_square(blocker)];
+
+	return piece != NO_PIECE && COLOR(piece) == color && (TYPE(piece) == QUEEN || TYPE(piece) == (diagonal ? BISHOP : ROOK));
+}
+
+/* returns true if a piece of the type and color on the square attacks the   */
+/* target square, with the given squares occupied.                           */
+static int attacks_square(int type, int color, int square, int target, uint64_t occupied) {
+	int direction;
+	int diagonal;
+
+	switch (type) {
+	case PAWN:
+		return pawn_attacks[color][square] >> target & 1;
+	case KNIGHT:
+		return knight_attacks[square] >> target & 1;
+	case BISHOP:
+	case ROOK:
+	case QUEEN:
+		direction = line_direction(square, target);
+		diagonal = direction == 0 || direction == 2 || direction == 5 || direction == 7;
+
+		if (direction < 0 || (type != QUEEN && type != (diagonal ? BISHOP : ROOK))) {
+			return 0;
 		}
 
-		to_square = add_offset(to_square, file_offset, rank_offset);
+		return ray_attacks(occupied, square, direction) >> target & 1;
 	}
 
-	return count;
+	return 0;
 }
 
-size_t generate_pseudo_legal_moves(const struct position *pos, struct move *moves) {
-	size_t count = 0;
-	int forward = pos->side_to_move == WHITE ? 1 : -1;
-	int square;
+int gives_check(const struct position *pos, struct move move) {
+	int color = pos->side_to_move;
+	int piece = pos->board[move.from_square];
+	int type = move.promotion_type != NO_TYPE ? move.promotion_type : TYPE(piece);
+	int king = king_square(pos, 1 - color);
+	int rank = RANK(move.from_square);
+	uint64_t occupied = (pos->occupied & ~((uint64_t)1 << move.from_square)) | (uint64_t)1 << move.to_square;
+	int direction;
+
+	if (king == NO_SQUARE) {
+		return 0;
+	}
+
+	/* a direct check by the piece on its new square.                        */
+	if (attacks_square(type, color, move.to_square, king, occupied)) {
+		return 1;
+	}
 
-	for (square = 0; square < 64; square++) {
-		int piece = pos->board[square];
+	/* en passant also empties the square of the captured pawn, which can    */
+	/* uncover a slider too, and castling checks with the rook.              */
+	if (TYPE(piece) == PAWN && move.to_square == pos->en_passant_square) {
+		int captured = SQUARE(FILE(move.to_square), rank);
 
-		/* skip this square if it is empty or contains an opponent piece.    */
-		if (piece == NO_PIECE || COLOR(piece) != pos->side_to_move) {
-			continue;
+		occupied &= ~((uint64_t)1 << captured);
+		direction = line_direction(king, captured);
+
+		if (direction >= 0 && slider_behind(pos, occupied, king, direction, color)) {
+			return 1;
 		}
+	} else if (TYPE(piece) == KING && FILE(move.from_square) == FILE_E && (FILE(move.to_square) == FILE_G || FILE(move.to_square) == FILE_C)) {
+		int kingside = FILE(move.to_square) == FILE_G;
+		int rook = SQUARE(kingside ? FILE_F : FILE_D, rank);
 
-		switch (TYPE(piece)) {
-			int up;
-			int up_up;
+		occupied ^= (uint64_t)1 << SQUARE(kingside ? FILE_H : FILE_A, rank) | (uint64_t)1 << rook;
 
-		case PAWN:
-			up = add_offset(square, 0, forward);
-			up_up = add_offset(square, 0, forward * 2);
+		if (attacks_square(ROOK, color, rook, king, occupied)) {
+			return 1;
+		}
+	}
+
+	/* a discovered check by a slider behind the from square.                */
+	direction = line_direction(king, move.from_square);
+
+	return direction >= 0 && slider_behind(pos, occupied, king, direction, color);
+}
 
-			/* pawn push.                                                    */
-			if (up != NO_SQUARE && pos->board[up] == NO_PIECE) {
-				count += generate_pawn_move(pos, moves + count, square, up);
+size_t generate_quiet_checks(const struct position *pos, struct move *moves) {
+	int color = pos->side_to_move;
+	int king = king_square(pos, 1 - color);
+	uint64_t occupied = pos->occupied;
+	uint64_t check_squares[6];
+	uint64_t discovered = 0;
+	size_t count = 0;
+	int direction;
+	int index;
+
+	if (king == NO_SQUARE) {
+		return 0;
+	}
+
+	/* the squares a piece of each type gives check from are the squares it  */
+	/* would attack from the enemy king, and for sliders those on the rays   */
+	/* up to the first piece.                                                */
+	check_squares[PAWN] = pawn_attacks[1 - color][king];
+	check_squares[KNIGHT] = knight_attacks[king];
+	check_squares[BISHOP] = 0;
+	check_squares[ROOK] = 0;
+	check_squares[KING] = 0;
+
+	for (direction = 0; direction < 8; direction++) {
+		uint64_t attacks = ray_attacks(occupied, king, direction);
+		uint64_t blocker = attacks & occupied;
+		int diagonal = direction == 0 || direction == 2 || direction == 5 || direction == 7;
+
+		check_squares[diagonal ? BISHOP : ROOK] |= attacks;
+
+		/* our piece that is the only one between the king and our slider    */
+		/* gives a discovered check when it leaves the ray.                  */
+		if (blocker && COLOR(pos->board[lowest_square(blocker)]) == color && slider_behind(pos, occupied & ~blocker, king, direction, color)) {
+			discovered |= blocker;
+		}
+	}
+
+	check_squares[QUEEN] = check_squares[BISHOP] | check_squares[ROOK];
 
-				/* double pawn push.                                         */
-				if (up_up != NO_SQUARE && pos->board[up_up] == NO_PIECE) {
-					if (RANK(square) == RELATIVE(RANK_2, COLOR(piece))) {
-						count += generate_pawn_move(pos, moves + count, square, up_up);
+	for (index = 0; index < pos->piece_count[color]; index++) {
+		int square = pos->pieces[color][index];
+		int type = TYPE(pos->board[square]);
+		uint64_t targets = 0;
+		uint64_t checks;
+
+		switch (type) {
+		case PAWN:
+			/* pushes to the last rank are promotions, which are not quiet,  */
+			/* and a pawn on the last rank can only come from a broken       */
+			/* position.                                                     */
+			if (RELATIVE(RANK(square), color) < RANK_7) {
+				int up = color == WHITE ? square + 8 : square - 8;
+				int up_up = color == WHITE ? up + 8 : up - 8;
+
+				if (pos->board[up] == NO_PIECE) {
+					targets = (uint64_t)1 << up;
+
+					if (RELATIVE(RANK(square), color) == RANK_2 && pos->board[up_up] == NO_PIECE) {
+						targets |= (uint64_t)1 << up_up;
 					}
 				}
 			}
 
-			/* pawn captures.                                                */
-			count += generate_pawn_capture(pos, moves + count, square, -1, forward);
-			count += generate_pawn_capture(pos, moves + count, square, 1, forward);
-
 			break;
 		case KNIGHT:
-			/* knight moves.                                                 */
-			count += generate_simple_move(pos, moves + count, square, -1, -2);
-			count += generate_simple_move(pos, moves + count, square, 1, -2);
-			count += generate_simple_move(pos, moves + count, square, -2, -1);
-			count += generate_simple_move(pos, moves + count, square, 2, -1);
-			count += generate_simple_move(pos, moves + count, square, -2, 1);
-			count += generate_simple_move(pos, moves + count, square, 2, 1);
-			count += generate_simple_move(pos, moves + count, square, -1, 2);
-			count += generate_simple_move(pos, moves + count, square, 1, 2);
-
+			targets = knight_attacks[square] & ~occupied;
 			break;
 		case BISHOP:
 		case ROOK:
 		case QUEEN:
-			/* bishop and queen moves.                                       */
-			if (TYPE(piece) != ROOK) {
-				count += generate_sliding_move(pos, moves + count, square, -1, -1);
-				count += generate_sliding_move(pos, moves + count, square, 1, -1);
-				count += generate_sliding_move(pos, moves + count, square, -1, 1);
-				count += generate_sliding_move(pos, moves + count, square, 1, 1);
-			}
+			for (direction = 0; direction < 8; direction++) {
+				int diagonal = direction == 0 || direction == 2 || direction == 5 || direction == 7;
 
-			/* rook and queen moves.                                         */
-			if (TYPE(piece) != BISHOP) {
-				count += generate_sliding_move(pos, moves + count, square, 0, -1);
-				count += generate_sliding_move(pos, moves + count, square, -1, 0);
-				count += generate_sliding_move(pos, moves + count, square, 1, 0);
-				count += generate_sliding_move(pos, moves + count, square, 0, 1);
+				if (type == QUEEN || type == (diagonal ? BISHOP : ROOK)) {
+					targets |= ray_attacks(occupied, square, direction) & ~occupied;
+				}
 			}
 
 			break;
 		case KING:
-			/* simple king moves.                                            */
-			count += generate_simple_move(pos, moves + count, square, -1, -1);
-			count += generate_simple_move(pos, moves + count, square, 0, -1);
-			count += generate_simple_move(pos, moves + count, square, 1, -1);
-			count += generate_simple_move(pos, moves + count, square, -1, 0);
-			count += generate_simple_move(pos, moves + count, square, 1, 0);
-			count += generate_simple_move(pos, moves + count, square, -1, 1);
-			count += generate_simple_move(pos, moves + count, square, 0, 1);
-			count += generate_simple_move(pos, moves + count, square, 1, 1);
-
-			/* king side castling.                                           */
-			if (pos->castling_rights[pos->side_to_move] & KING_SIDE) {
-				int f1 = SQUARE(FILE_F, RELATIVE(RANK_1, pos->side_to_move));
-				int g1 = SQUARE(FILE_G, RELATIVE(RANK_1, pos->side_to_move));
-				int f1_empty = pos->board[f1] == NO_PIECE;
-				int g1_empty = pos->board[g1] == NO_PIECE;
-
-				if (f1_empty && g1_empty) {
-					moves[count++] = make_move(square, g1, NO_TYPE);
-				}
+			targets = king_attacks[square] & ~occupied;
+
+			/* castling can only give check with the rook, which is rare     */
+			/* enough to just test the moves.                                */
+			if (pos->castling_rights[color] & KING_SIDE && !(occupied & ((uint64_t)3 << SQUARE(FILE_F, RELATIVE(RANK_1, color))))) {
+				moves[count] = make_move(square, SQUARE(FILE_G, RELATIVE(RANK_1, color)), NO_TYPE);
+				count += gives_check(pos, moves[count]);
 			}
 
-			/* queen side castling.                                          */
-			if (pos->castling_rights[pos->side_to_move] & QUEEN_SIDE) {
-				int b1 = SQUARE(FILE_B, RELATIVE(RANK_1, pos->side_to_move));
-				int c1 = SQUARE(FILE_C, RELATIVE(RANK_1, pos->side_to_move));
-				int d1 = SQUARE(FILE_D, RELATIVE(RANK_1, pos->side_to_move));
-				int b1_empty = pos->board[b1] == NO_PIECE;
-				int c1_empty = pos->board[c1] == NO_PIECE;
-				int d1_empty = pos->board[d1] == NO_PIECE;
-
-				if (b1_empty && c1_empty && d1_empty) {
-					moves[count++] = make_move(square, c1, NO_TYPE);
-				}
+			if (pos->castling_rights[color] & QUEEN_SIDE && !(occupied & ((uint64_t)7 << SQUARE(FILE_B, RELATIVE(RANK_1, color))))) {
+				moves[count] = make_move(square, SQUARE(FILE_C, RELATIVE(RANK_1, color)), NO_TYPE);
+				count += gives_check(pos, moves[count]);
 			}
 
 			break;
 		}
-	}
 
-	return count;
-}
+		checks = targets & check_squares[type];
 
-size_t generate_legal_moves(const struct position *pos, struct move *moves) {
-	size_t pseudo_legal_count = generate_pseudo_legal_moves(pos, moves);
-	size_t index;
-	size_t count = 0;
+		if (discovered >> square & 1) {
+			checks |= targets & ~ray_masks[king][line_direction(king, square)];
+		}
 
-	for (index = 0; index < pseudo_legal_count; index++) {
-		if (is_legal(pos, moves[index])) {
-			moves[count++] = moves[index];
+		for (; checks; checks &= checks - 1) {
+			moves[count++] = make_move(square, lowest_square(checks), NO_TYPE);
 		}
 	}
 
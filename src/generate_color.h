@@ -0,0 +1,173 @@
+/* move generation for one color. this file is included twice by             */
+/* `generate.c`, once for each color, with `US` and `THEM` defined as        */
+/* `WHITE` and `BLACK` or the other way around, and `SPECIALIZE(name)`       */
+/* adding a color suffix to the function names. since the color is a         */
+/* constant, the compiler can fold the pawn direction, the promotion rank    */
+/* and the castling squares, and drop the branches on the side to move.      */
+
+/* generate a pawn move, taking into account promotions. returns the number  */
+/* of moves generated.                                                       */
+static size_t SPECIALIZE(generate_pawn_move)(struct move *moves, int from_square, int to_square) {
+	size_t count = 0;
+
+	if (RANK(to_square) == RELATIVE(RANK_8, US)) {
+		moves[count++] = make_move(from_square, to_square, KNIGHT);
+		moves[count++] = make_move(from_square, to_square, BISHOP);
+		moves[count++] = make_move(from_square, to_square, ROOK);
+		moves[count++] = make_move(from_square, to_square, QUEEN);
+	} else {
+		moves[count++] = make_move(from_square, to_square, NO_TYPE);
+	}
+
+	return count;
+}
+
+/* generate a pawn capture, taking into account promotions. this function    */
+/* makes sure that the destination square contains an opponent piece or is   */
+/* the en passant square. returns the number of moves generated.             */
+static size_t SPECIALIZE(generate_pawn_capture)(const struct position *pos, struct move *moves, int from_square, int to_square) {
+	int piece = pos->board[to_square];
+	int capture = piece != NO_PIECE && COLOR(piece) == THEM;
+
+	if (capture || to_square == pos->en_passant_square) {
+		return SPECIALIZE(generate_pawn_move)(moves, from_square, to_square);
+	}
+
+	return 0;
+}
+
+/* generate simple, non-sliding moves to the squares in the list, which ends */
+/* with -1. this function makes sure that the destination square is empty or */
+/* contains an opponent piece. returns the number of moves generated.        */
+static size_t SPECIALIZE(generate_simple_moves)(const struct position *pos, struct move *moves, int from_square, const signed char *to_squares) {
+	size_t count = 0;
+
+	for (; *to_squares != NO_SQUARE; to_squares++) {
+		int piece = pos->board[*to_squares];
+
+		if (piece == NO_PIECE || COLOR(piece) == THEM) {
+			moves[count++] = make_move(from_square, *to_squares, NO_TYPE);
+		}
+	}
+
+	return count;
+}
+
+/* generate sliding moves along the ray, which ends with -1. this function   */
+/* stops at the first piece on the ray. returns the number of moves          */
+/* generated.                                                                */
+static size_t SPECIALIZE(generate_sliding_moves)(const struct position *pos, struct move *moves, int from_square, const signed char *ray) {
+	size_t count = 0;
+
+	for (; *ray != NO_SQUARE; ray++) {
+		int piece = pos->board[*ray];
+
+		if (piece == NO_PIECE || COLOR(piece) == THEM) {
+			moves[count++] = make_move(from_square, *ray, NO_TYPE);
+		}
+
+		if (piece != NO_PIECE) {
+			break;
+		}
+	}
+
+	return count;
+}
+
+static size_t SPECIALIZE(generate_pseudo_legal_moves)(const struct position *pos, struct move *moves) {
+	size_t count = 0;
+	int index;
+
+	for (index = 0; index < pos->piece_count[US]; index++) {
+		int square = pos->pieces[US][index];
+		int piece = pos->board[square];
+
+		switch (TYPE(piece)) {
+			const signed char *to_squares;
+			int direction;
+			int up;
+
+		case PAWN:
+			/* a pawn on the last rank can only come from a broken position, */
+			/* and it has nowhere to go.                                     */
+			if (RANK(square) == RELATIVE(RANK_8, US)) {
+				break;
+			}
+
+			up = US == WHITE ? square + 8 : square - 8;
+
+			/* pawn push.                                                    */
+			if (pos->board[up] == NO_PIECE) {
+				count += SPECIALIZE(generate_pawn_move)(moves + count, square, up);
+
+				/* double pawn push.                                         */
+				if (RANK(square) == RELATIVE(RANK_2, US)) {
+					int up_up = US == WHITE ? up + 8 : up - 8;
+
+					if (pos->board[up_up] == NO_PIECE) {
+						moves[count++] = make_move(square, up_up, NO_TYPE);
+					}
+				}
+			}
+
+			/* pawn captures.                                                */
+			for (to_squares = pawn_captures[US][square]; *to_squares != NO_SQUARE; to_squares++) {
+				count += SPECIALIZE(generate_pawn_capture)(pos, moves + count, square, *to_squares);
+			}
+
+			break;
+		case KNIGHT:
+			/* knight moves.                                                 */
+			count += SPECIALIZE(generate_simple_moves)(pos, moves + count, square, knight_moves[square]);
+
+			break;
+		case BISHOP:
+		case ROOK:
+		case QUEEN:
+			/* the rays are in the same order as the king moves, with the    */
+			/* diagonals at indices 0, 2, 5 and 7.                           */
+			for (direction = 0; direction < 8; direction++) {
+				int diagonal = direction == 0 || direction == 2 || direction == 5 || direction == 7;
+
+				if (TYPE(piece) == QUEEN || TYPE(piece) == (diagonal ? BISHOP : ROOK)) {
+					count += SPECIALIZE(generate_sliding_moves)(pos, moves + count, square, rays[square][direction]);
+				}
+			}
+
+			break;
+		case KING:
+			/* simple king moves.                                            */
+			count += SPECIALIZE(generate_simple_moves)(pos, moves + count, square, king_moves[square]);
+
+			/* king side castling.                                           */
+			if (pos->castling_rights[US] & KING_SIDE) {
+				int f1 = SQUARE(FILE_F, RELATIVE(RANK_1, US));
+				int g1 = SQUARE(FILE_G, RELATIVE(RANK_1, US));
+				int f1_empty = pos->board[f1] == NO_PIECE;
+				int g1_empty = pos->board[g1] == NO_PIECE;
+
+				if (f1_empty && g1_empty) {
+					moves[count++] = make_move(square, g1, NO_TYPE);
+				}
+			}
+
+			/* queen side castling.                                          */
+			if (pos->castling_rights[US] & QUEEN_SIDE) {
+				int b1 = SQUARE(FILE_B, RELATIVE(RANK_1, US));
+				int c1 = SQUARE(FILE_C, RELATIVE(RANK_1, US));
+				int d1 = SQUARE(FILE_D, RELATIVE(RANK_1, US));
+				int b1_empty = pos->board[b1] == NO_PIECE;
+				int c1_empty = pos->board[c1] == NO_PIECE;
+				int d1_empty = pos->board[d1] == NO_PIECE;
+
+				if (b1_empty && c1_empty && d1_empty) {
+					moves[count++] = make_move(square, c1, NO_TYPE);
+				}
+			}
+
+			break;
+		}
+	}
+
+	return count;
+}
@@ -1,15 +1,53 @@
+#include "analyze.h"
+#include "bookgen.h"
+#include "match.h"
+#include "microbench.h"
 #include "perft.h"
+#include "profile.h"
+#include "tbgen.h"
+#include "types.h"
 #include "uci.h"
 
 #include <stdlib.h>
+#include <string.h>
 
 #define PERFT 0
 
-int main(void) {
+#if PROFILE
+static void print_profile(void) {
+	profile_report(stderr, "");
+}
+#endif
+
+int main(int argc, char **argv) {
+#if PROFILE
+	atexit(print_profile);
+#endif
+
+	if (argc > 1 && !strcmp(argv[1], "analyze")) {
+		return analyze_run(argc - 2, argv + 2) == SUCCESS ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
+
+	if (argc > 1 && !strcmp(argv[1], "bookgen")) {
+		return bookgen_run(argc - 2, argv + 2) == SUCCESS ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
+
+	if (argc > 1 && !strcmp(argv[1], "match")) {
+		return match_run(argc - 2, argv + 2) == SUCCESS ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
+
+	if (argc > 1 && !strcmp(argv[1], "microbench")) {
+		return microbench_run(argc - 2, argv + 2) == SUCCESS ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
+
+	if (argc > 1 && !strcmp(argv[1], "tbgen")) {
+		return tbgen_run(argc - 2, argv + 2) == SUCCESS ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
+
 #if PERFT
 	perft_run();
 #else
-	uci_run("example engine", "csteenvo");
+	uci_run("Team Alpaca", "aalombro tcakir-y yulpark");
 #endif
 
 	return EXIT_SUCCESS;
@@ -0,0 +1,513 @@
+#define _POSIX_C_SOURCE 200112L
+
+#include "match.h"
+#include "generate.h"
+#include "position.h"
+#include "search.h"
+#include "types.h"
+
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define START_FEN "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1"
+
+/* the longest line read from the openings file.                             */
+#define MAX_LINE 1024
+
+/* the longest opening we keep, longer ones can not be valid FEN strings.    */
+#define MAX_FEN 128
+
+/* game results, from the perspective of white or of configuration `a`.      */
+#define RESULT_LOSS 0
+#define RESULT_DRAW 1
+#define RESULT_WIN 2
+
+/* the outcome of the sequential probability ratio test.                     */
+#define SPRT_RUNNING 0
+#define SPRT_H0 1
+#define SPRT_H1 2
+
+/* the settings of one side in a match, 0 means not set.                     */
+struct config {
+	int time;
+	int increment;
+	int depth;
+	unsigned long nodes;
+	int movetime;
+	struct search_params params;
+};
+
+struct match {
+	struct config configs[2];
+	int game_count;
+	int thread_count;
+	char (*openings)[MAX_FEN];
+	int opening_count;
+	double elo0;
+	double elo1;
+	double alpha;
+	double beta;
+	double start_time;
+
+	/* everything below is shared between threads and protected by `mutex`.  */
+	pthread_mutex_t mutex;
+	int next_game;
+	int finished_games;
+	int results[3];
+	int time_losses;
+	int sprt;
+};
+
+/* the state of a worker thread, reused for all its games.                   */
+struct worker {
+	struct match *match;
+	struct position pos;
+	struct history history;
+
+	/* the search memory of both configurations, by their index.             */
+	struct search_context contexts[2];
+	pthread_t thread;
+};
+
+static double get_time(void) {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* returns the number of times the position occurred before, looking back    */
+/* no further than the last capture or pawn move.                            */
+static int repetitions(const struct history *history, const struct position *pos) {
+	int count = 0;
+	int distance;
+
+	for (distance = 4; distance <= pos->halfmove_clock && distance <= history->count; distance += 2) {
+		if (history->keys[history->count - distance] == pos->key) {
+			count++;
+		}
+	}
+
+	return count;
+}
+
+/* returns true if neither side can checkmate: only kings, or kings and a    */
+/* single knight or bishop.                                                  */
+static int insufficient_material(const struct position *pos) {
+	int minors = 0;
+	int color;
+	int index;
+
+	for (color = WHITE; color <= BLACK; color++) {
+		for (index = 0; index < pos->piece_count[color]; index++) {
+			int type = TYPE(pos->board[pos->pieces[color][index]]);
+
+			if (type == KING) {
+				continue;
+			}
+
+			if (type != KNIGHT && type != BISHOP) {
+				return 0;
+			}
+
+			minors++;
+		}
+	}
+
+	return minors <= 1;
+}
+
+/* play a game from the opening, with configuration `white` playing white.   */
+/* returns the result for white, and sets `time_loss` if the game was lost   */
+/* on time.                                                                  */
+static int play_game(struct worker *worker, const char *fen, int white, int *time_loss) {
+	const struct match *match = worker->match;
+	struct position *pos = &worker->pos;
+	struct move moves[MAX_MOVES];
+	int clocks[2];
+
+	*time_loss = 0;
+	parse_position(pos, fen);
+	worker->history.count = 0;
+	clocks[WHITE] = match->configs[white].time;
+	clocks[BLACK] = match->configs[1 - white].time;
+
+	for (;;) {
+		int color = pos->side_to_move;
+		int index = color == WHITE ? white : 1 - white;
+		const struct config *config = &match->configs[index];
+		struct search_info info;
+		struct search_result result;
+		double start;
+
+		if (generate_legal_moves(pos, moves) == 0) {
+			if (!in_check(pos)) {
+				return RESULT_DRAW;
+			}
+
+			return color == WHITE ? RESULT_LOSS : RESULT_WIN;
+		}
+
+		if (pos->halfmove_clock >= 100 || repetitions(&worker->history, pos) >= 2 || insufficient_material(pos)) {
+			return RESULT_DRAW;
+		}
+
+		/* the search only looks at the clock of the side to move.           */
+		info.pos = pos;
+		info.history = &worker->history;
+		info.time[WHITE] = clocks[WHITE];
+		info.time[BLACK] = clocks[BLACK];
+		info.increment[WHITE] = config->increment;
+		info.increment[BLACK] = config->increment;
+		info.depth = config->depth;
+		info.nodes = config->nodes;
+		info.movetime = config->movetime;
+		info.print_info = 0;
+		info.params = &config->params;
+		info.multipv = 1;
+		info.searchmoves = NULL;
+		info.searchmoves_count = 0;
+		info.control = NULL;
+		info.context = &worker->contexts[index];
+
+		start = get_time();
+		result = search(&info);
+
+		if (config->time) {
+			clocks[color] -= (int)((get_time() - start) * 1000);
+
+			if (clocks[color] < 0) {
+				*time_loss = 1;
+
+				return color == WHITE ? RESULT_LOSS : RESULT_WIN;
+			}
+
+			clocks[color] += config->increment;
+		}
+
+		history_push(&worker->history, pos);
+		do_move(pos, result.move);
+
+		/* positions before a capture or pawn move can not repeat.           */
+		if (pos->halfmove_clock == 0) {
+			worker->history.count = 0;
+		}
+	}
+}
+
+/* returns the log-likelihood ratio of the results for an elo difference of  */
+/* `elo1` against one of `elo0`, using a normal approximation of the score.  */
+/* like other tools, we wait for at least one win, draw, and loss: before    */
+/* that the variance is too far off for the test to mean anything.           */
+static double sprt_llr(const int results[3], double elo0, double elo1) {
+	double games = results[RESULT_LOSS] + results[RESULT_DRAW] + results[RESULT_WIN];
+	double wins;
+	double draws;
+	double score;
+	double variance;
+	double score0 = 1 / (1 + pow(10, -elo0 / 400));
+	double score1 = 1 / (1 + pow(10, -elo1 / 400));
+
+	if (!results[RESULT_LOSS] || !results[RESULT_DRAW] || !results[RESULT_WIN]) {
+		return 0;
+	}
+
+	wins = results[RESULT_WIN] / games;
+	draws = results[RESULT_DRAW] / games;
+	score = wins + draws / 2;
+	variance = wins + draws / 4 - score * score;
+
+	return games * (score1 - score0) * (2 * score - score0 - score1) / (2 * variance);
+}
+
+/* print the running score of configuration `a`. must be called with the     */
+/* mutex locked.                                                             */
+static void print_score(const struct match *match, FILE *stream) {
+	double games = match->finished_games;
+	double score = games > 0 ? (match->results[RESULT_WIN] + match->results[RESULT_DRAW] / 2.0) / games : 0.5;
+	double llr = sprt_llr(match->results, match->elo0, match->elo1);
+	double elapsed = get_time() - match->start_time;
+
+	fprintf(stream, "games %d: +%d =%d -%d, score %.1f%%", match->finished_games, match->results[RESULT_WIN], match->results[RESULT_DRAW], match->results[RESULT_LOSS], score * 100);
+
+	if (score > 0 && score < 1) {
+		fprintf(stream, ", elo %+.1f", -400 * log10(1 / score - 1));
+	}
+
+	fprintf(stream, ", llr %.2f (%.2f, %.2f), %.0f games per hour\n", llr, log(match->beta / (1 - match->alpha)), log((1 - match->beta) / match->alpha), games * 3600 / (elapsed > 0 ? elapsed : 1));
+	fflush(stream);
+}
+
+static void *match_worker(void *arg) {
+	struct worker *worker = arg;
+	struct match *match = worker->match;
+
+	if (search_context_init(&worker->contexts[0]) != SUCCESS) {
+		fprintf(stderr, "match: out of memory\n");
+
+		return NULL;
+	}
+
+	if (search_context_init(&worker->contexts[1]) != SUCCESS) {
+		fprintf(stderr, "match: out of memory\n");
+		search_context_free(&worker->contexts[0]);
+
+		return NULL;
+	}
+
+	pthread_mutex_lock(&match->mutex);
+
+	while (match->next_game < match->game_count && match->sprt == SPRT_RUNNING) {
+		int game = match->next_game++;
+		const char *fen = match->opening_count ? match->openings[game / 2 % match->opening_count] : START_FEN;
+		int white = game % 2;
+		int result;
+		int time_loss;
+		double llr;
+
+		pthread_mutex_unlock(&match->mutex);
+		result = play_game(worker, fen, white, &time_loss);
+		pthread_mutex_lock(&match->mutex);
+
+		/* count the result from the perspective of configuration `a`.       */
+		match->results[white == 0 ? result : RESULT_WIN - result]++;
+		match->time_losses += time_loss;
+		match->finished_games++;
+		llr = sprt_llr(match->results, match->elo0, match->elo1);
+
+		if (llr <= log(match->beta / (1 - match->alpha))) {
+			match->sprt = SPRT_H0;
+		} else if (llr >= log((1 - match->beta) / match->alpha)) {
+			match->sprt = SPRT_H1;
+		}
+
+		if (match->finished_games % 10 == 0) {
+			print_score(match, stderr);
+		}
+	}
+
+	pthread_mutex_unlock(&match->mutex);
+	search_context_free(&worker->contexts[0]);
+	search_context_free(&worker->contexts[1]);
+
+	return NULL;
+}
+
+/* parse a comma separated list of settings, see `match.h`.                  */
+static int parse_config(struct config *config, const char *string) {
+	char buffer[256];
+	char *setting;
+
+	if (strlen(string) >= sizeof buffer) {
+		return FAILURE;
+	}
+
+	strcpy(buffer, string);
+	config->time = 0;
+	config->increment = 0;
+	config->depth = 0;
+	config->nodes = 0;
+	config->movetime = 0;
+	search_params_init(&config->params);
+
+	for (setting = strtok(buffer, ","); setting; setting = strtok(NULL, ",")) {
+		char *value = strchr(setting, '=');
+
+		if (!value) {
+			return FAILURE;
+		}
+
+		*value++ = '\0';
+
+		if (!strcmp(setting, "tc")) {
+			char *increment = strchr(value, '+');
+
+			config->time = (int)(atof(value) * 1000);
+			config->increment = increment ? (int)(atof(increment + 1) * 1000) : 0;
+
+			if (config->time <= 0) {
+				return FAILURE;
+			}
+		} else if (!strcmp(setting, "depth")) {
+			config->depth = atoi(value);
+		} else if (!strcmp(setting, "nodes")) {
+			config->nodes = strtoul(value, NULL, 10);
+		} else if (!strcmp(setting, "movetime")) {
+			config->movetime = atoi(value);
+		} else if (search_params_set(&config->params, setting, atoi(value)) != SUCCESS) {
+			return FAILURE;
+		}
+	}
+
+	return SUCCESS;
+}
+
+/* read all valid positions from the openings file.                          */
+static int read_openings(struct match *match, const char *path) {
+	FILE *stream = fopen(path, "r");
+	char line[MAX_LINE];
+	char fen[MAX_LINE];
+	int capacity = 0;
+
+	if (!stream) {
+		fprintf(stderr, "match: could not open %s\n", path);
+
+		return FAILURE;
+	}
+
+	while (fgets(line, sizeof line, stream)) {
+		struct position pos;
+
+		if (epd_to_fen(fen, sizeof fen, line) != SUCCESS || strlen(fen) >= MAX_FEN || parse_position(&pos, fen) != SUCCESS) {
+			continue;
+		}
+
+		if (match->opening_count == capacity) {
+			char (*openings)[MAX_FEN];
+
+			capacity = capacity ? capacity * 2 : 256;
+			openings = realloc(match->openings, capacity * sizeof *openings);
+
+			if (!openings) {
+				fclose(stream);
+
+				return FAILURE;
+			}
+
+			match->openings = openings;
+		}
+
+		strcpy(match->openings[match->opening_count++], fen);
+	}
+
+	fclose(stream);
+
+	if (match->opening_count == 0) {
+		fprintf(stderr, "match: no positions in %s\n", path);
+
+		return FAILURE;
+	}
+
+	return SUCCESS;
+}
+
+static int parse_options(struct match *match, int argc, char **argv) {
+	int index;
+
+	parse_config(&match->configs[0], "tc=10+0.1");
+	parse_config(&match->configs[1], "tc=10+0.1");
+	match->game_count = 1000;
+	match->thread_count = (int)sysconf(_SC_NPROCESSORS_ONLN);
+	match->elo0 = 0;
+	match->elo1 = 5;
+	match->alpha = 0.05;
+	match->beta = 0.05;
+
+	for (index = 0; index < argc; index += 2) {
+		const char *option = argv[index];
+		const char *value = index + 1 < argc ? argv[index + 1] : NULL;
+
+		if (!value) {
+			return FAILURE;
+		} else if (!strcmp(option, "-a")) {
+			if (parse_config(&match->configs[0], value) != SUCCESS) {
+				return FAILURE;
+			}
+		} else if (!strcmp(option, "-b")) {
+			if (parse_config(&match->configs[1], value) != SUCCESS) {
+				return FAILURE;
+			}
+		} else if (!strcmp(option, "-games")) {
+			match->game_count = atoi(value);
+		} else if (!strcmp(option, "-threads")) {
+			match->thread_count = atoi(value);
+		} else if (!strcmp(option, "-openings")) {
+			if (read_openings(match, value) != SUCCESS) {
+				return FAILURE;
+			}
+		} else if (!strcmp(option, "-sprt") && index + 2 < argc) {
+			match->elo0 = atof(value);
+			match->elo1 = atof(argv[++index + 1]);
+		} else if (!strcmp(option, "-alpha")) {
+			match->alpha = atof(value);
+		} else if (!strcmp(option, "-beta")) {
+			match->beta = atof(value);
+		} else {
+			return FAILURE;
+		}
+	}
+
+	if (match->game_count <= 0 || match->elo0 >= match->elo1) {
+		return FAILURE;
+	}
+
+	if (match->alpha <= 0 || match->alpha >= 1 || match->beta <= 0 || match->beta >= 1) {
+		return FAILURE;
+	}
+
+	if (match->thread_count < 1) {
+		match->thread_count = 1;
+	}
+
+	return SUCCESS;
+}
+
+int match_run(int argc, char **argv) {
+	static const char *outcomes[] = { "inconclusive", "H0 accepted, not stronger", "H1 accepted, stronger" };
+	struct match match;
+	struct worker *workers;
+	int index;
+
+	match.openings = NULL;
+	match.opening_count = 0;
+
+	if (parse_options(&match, argc, argv) != SUCCESS) {
+		fprintf(stderr, "usage: match [-a config] [-b config] [-games n] [-threads n] [-openings file] [-sprt elo0 elo1] [-alpha a] [-beta b]\n");
+		free(match.openings);
+
+		return FAILURE;
+	}
+
+	workers = malloc(match.thread_count * sizeof *workers);
+
+	if (!workers) {
+		fprintf(stderr, "match: out of memory\n");
+		free(match.openings);
+
+		return FAILURE;
+	}
+
+	pthread_mutex_init(&match.mutex, NULL);
+	match.next_game = 0;
+	match.finished_games = 0;
+	match.results[RESULT_LOSS] = 0;
+	match.results[RESULT_DRAW] = 0;
+	match.results[RESULT_WIN] = 0;
+	match.time_losses = 0;
+	match.sprt = SPRT_RUNNING;
+	match.start_time = get_time();
+
+	for (index = 0; index < match.thread_count; index++) {
+		workers[index].match = &match;
+		pthread_create(&workers[index].thread, NULL, match_worker, &workers[index]);
+	}
+
+	for (index = 0; index < match.thread_count; index++) {
+		pthread_join(workers[index].thread, NULL);
+	}
+
+	print_score(&match, stdout);
+	printf("%d games lost on time, sprt: %s\n", match.time_losses, outcomes[match.sprt]);
+
+	pthread_mutex_destroy(&match.mutex);
+	free(match.openings);
+	free(workers);
+
+	return SUCCESS;
+}
@@ -0,0 +1,552 @@
+#ifdef __linux__
+#define _GNU_SOURCE
+#include <sched.h>
+#else
+#define _POSIX_C_SOURCE 200112L
+#endif
+
+#include "microbench.h"
+#include "cpu.h"
+#include "evaluate.h"
+#include "generate.h"
+#include "move.h"
+#include "position.h"
+#include "types.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* the longest line we read, longer lines are skipped.                       */
+#define MAX_LINE 1024
+
+/* enough for any FEN we write.                                              */
+#define MAX_FEN 96
+
+/* the longest random game, after which the next one is started.             */
+#define GAME_PLIES 200
+
+/* a move together with the position it is played in.                        */
+struct bench_move {
+	size_t position;
+	struct move move;
+};
+
+struct bench {
+	unsigned long position_count;
+	int runs;
+	int warmup;
+	unsigned long seed;
+	int cpu;
+	FILE *input;
+
+	struct position *positions;
+	char (*fens)[MAX_FEN];
+	struct bench_move *pseudo_legal_moves;
+	size_t pseudo_legal_count;
+	struct bench_move *legal_moves;
+	size_t legal_count;
+};
+
+/* a primitive to time. returns the number of operations it did, and folds   */
+/* their results into `sink` so the compiler can not drop them.              */
+struct primitive {
+	const char *name;
+	size_t (*run)(const struct bench *bench);
+};
+
+static volatile unsigned long sink;
+
+static const char *seed_fens[] = {
+	"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+	"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+	"8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+	"r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+	"rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+	"r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+};
+
+/* returns the next number of a xorshift generator.                          */
+static unsigned long next_random(unsigned long *state) {
+	*state ^= (*state << 13) & 0xFFFFFFFFUL;
+	*state ^= *state >> 17;
+	*state ^= (*state << 5) & 0xFFFFFFFFUL;
+
+	return *state;
+}
+
+static double get_time(void) {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* write the FEN of the position, with 1 as the fullmove number, which the   */
+/* position does not keep.                                                   */
+static void format_fen(char *fen, const struct position *pos) {
+	int rank;
+	int file;
+
+	for (rank = 7; rank >= 0; rank--) {
+		int empty = 0;
+
+		for (file = 0; file < 8; file++) {
+			int piece = pos->board[SQUARE(file, rank)];
+
+			if (piece == NO_PIECE) {
+				empty++;
+				continue;
+			}
+
+			if (empty) {
+				*fen++ = '0' + empty;
+				empty = 0;
+			}
+
+			*fen++ = "PpNnBbRrQqKk"[piece];
+		}
+
+		if (empty) {
+			*fen++ = '0' + empty;
+		}
+
+		*fen++ = rank > 0 ? '/' : ' ';
+	}
+
+	*fen++ = "wb"[pos->side_to_move];
+	*fen++ = ' ';
+
+	if (!pos->castling_rights[WHITE] && !pos->castling_rights[BLACK]) {
+		*fen++ = '-';
+	}
+
+	if (pos->castling_rights[WHITE] & KING_SIDE) {
+		*fen++ = 'K';
+	}
+
+	if (pos->castling_rights[WHITE] & QUEEN_SIDE) {
+		*fen++ = 'Q';
+	}
+
+	if (pos->castling_rights[BLACK] & KING_SIDE) {
+		*fen++ = 'k';
+	}
+
+	if (pos->castling_rights[BLACK] & QUEEN_SIDE) {
+		*fen++ = 'q';
+	}
+
+	*fen++ = ' ';
+
+	if (pos->en_passant_square == NO_SQUARE) {
+		*fen++ = '-';
+	} else {
+		*fen++ = "abcdefgh"[FILE(pos->en_passant_square)];
+		*fen++ = '1' + RANK(pos->en_passant_square);
+	}
+
+	sprintf(fen, " %d 1", pos->halfmove_clock);
+}
+
+/* read positions from the input until there are enough of them. returns the */
+/* number of positions read.                                                 */
+static size_t read_positions(struct bench *bench) {
+	char line[MAX_LINE];
+	char fen[MAX_LINE];
+	unsigned long line_number = 0;
+	size_t count = 0;
+
+	while (count < bench->position_count && fgets(line, sizeof line, bench->input)) {
+		line_number++;
+
+		if (line[0] == '\n' || line[0] == '\r' || line[0] == '#') {
+			continue;
+		}
+
+		if (epd_to_fen(fen, sizeof fen, line) != SUCCESS || parse_position(&bench->positions[count], fen) != SUCCESS) {
+			fprintf(stderr, "microbench: skipping invalid position on line %lu\n", line_number);
+			continue;
+		}
+
+		count++;
+	}
+
+	return count;
+}
+
+/* fill the positions by playing random games from the seed positions.       */
+static void play_positions(struct bench *bench) {
+	struct move moves[MAX_MOVES];
+	unsigned long random = bench->seed ? bench->seed : 1;
+	size_t count = 0;
+	size_t game;
+
+	for (game = 0; count < bench->position_count; game++) {
+		struct position pos;
+		int ply;
+
+		parse_position(&pos, seed_fens[game % (sizeof seed_fens / sizeof *seed_fens)]);
+
+		for (ply = 0; ply < GAME_PLIES && count < bench->position_count; ply++) {
+			size_t move_count = generate_legal_moves(&pos, moves);
+
+			if (move_count == 0 || pos.halfmove_clock >= 100) {
+				break;
+			}
+
+			bench->positions[count++] = pos;
+			do_move(&pos, moves[next_random(&random) % move_count]);
+		}
+	}
+}
+
+/* collect the moves and FENs that the primitives work on.                   */
+static int prepare(struct bench *bench) {
+	struct move moves[MAX_MOVES];
+	struct position parsed;
+	size_t position;
+	size_t index;
+
+	bench->pseudo_legal_count = 0;
+	bench->legal_count = 0;
+
+	for (position = 0; position < bench->position_count; position++) {
+		const struct position *pos = &bench->positions[position];
+
+		bench->pseudo_legal_count += generate_pseudo_legal_moves(pos, moves);
+		bench->legal_count += generate_legal_moves(pos, moves);
+	}
+
+	bench->fens = malloc(bench->position_count * sizeof *bench->fens);
+	bench->pseudo_legal_moves = malloc((bench->pseudo_legal_count + 1) * sizeof *bench->pseudo_legal_moves);
+	bench->legal_moves = malloc((bench->legal_count + 1) * sizeof *bench->legal_moves);
+
+	if (!bench->fens || !bench->pseudo_legal_moves || !bench->legal_moves) {
+		return FAILURE;
+	}
+
+	bench->pseudo_legal_count = 0;
+	bench->legal_count = 0;
+
+	for (position = 0; position < bench->position_count; position++) {
+		const struct position *pos = &bench->positions[position];
+		size_t count = generate_pseudo_legal_moves(pos, moves);
+
+		for (index = 0; index < count; index++) {
+			bench->pseudo_legal_moves[bench->pseudo_legal_count].position = position;
+			bench->pseudo_legal_moves[bench->pseudo_legal_count++].move = moves[index];
+		}
+
+		count = generate_legal_moves(pos, moves);
+
+		for (index = 0; index < count; index++) {
+			bench->legal_moves[bench->legal_count].position = position;
+			bench->legal_moves[bench->legal_count++].move = moves[index];
+		}
+
+		format_fen(bench->fens[position], pos);
+
+		/* the FEN must give back the same position, or `parse_position`     */
+		/* would be timed on its error path.                                 */
+		if (parse_position(&parsed, bench->fens[position]) != SUCCESS || parsed.key != pos->key) {
+			fprintf(stderr, "microbench: could not write %s\n", bench->fens[position]);
+
+			return FAILURE;
+		}
+	}
+
+	return SUCCESS;
+}
+
+static size_t run_pseudo_legal(const struct bench *bench) {
+	struct move moves[MAX_MOVES];
+	unsigned long sum = 0;
+	size_t index;
+
+	for (index = 0; index < bench->position_count; index++) {
+		sum += generate_pseudo_legal_moves(&bench->positions[index], moves);
+	}
+
+	sink += sum;
+
+	return bench->position_count;
+}
+
+static size_t run_legal(const struct bench *bench) {
+	struct move moves[MAX_MOVES];
+	unsigned long sum = 0;
+	size_t index;
+
+	for (index = 0; index < bench->position_count; index++) {
+		sum += generate_legal_moves(&bench->positions[index], moves);
+	}
+
+	sink += sum;
+
+	return bench->position_count;
+}
+
+static size_t run_is_legal(const struct bench *bench) {
+	unsigned long sum = 0;
+	size_t index;
+
+	for (index = 0; index < bench->pseudo_legal_count; index++) {
+		const struct bench_move *move = &bench->pseudo_legal_moves[index];
+
+		sum += is_legal(&bench->positions[move->position], move->move);
+	}
+
+	sink += sum;
+
+	return bench->pseudo_legal_count;
+}
+
+static size_t run_do_move(const struct bench *bench) {
+	unsigned long sum = 0;
+	size_t index;
+
+	for (index = 0; index < bench->legal_count; index++) {
+		const struct bench_move *move = &bench->legal_moves[index];
+		struct position copy = bench->positions[move->position];
+
+		do_move(&copy, move->move);
+		sum += (unsigned long)copy.key;
+	}
+
+	sink += sum;
+
+	return bench->legal_count;
+}
+
+static size_t run_quiet_checks(const struct bench *bench) {
+	struct move moves[MAX_MOVES];
+	unsigned long sum = 0;
+	size_t index;
+
+	for (index = 0; index < bench->position_count; index++) {
+		sum += generate_quiet_checks(&bench->positions[index], moves);
+	}
+
+	sink += sum;
+
+	return bench->position_count;
+}
+
+static size_t run_gives_check(const struct bench *bench) {
+	unsigned long sum = 0;
+	size_t index;
+
+	for (index = 0; index < bench->legal_count; index++) {
+		const struct bench_move *move = &bench->legal_moves[index];
+
+		sum += gives_check(&bench->positions[move->position], move->move);
+	}
+
+	sink += sum;
+
+	return bench->legal_count;
+}
+
+static size_t run_evaluate(const struct bench *bench) {
+	unsigned long sum = 0;
+	size_t index;
+
+	for (index = 0; index < bench->position_count; index++) {
+		sum += evaluate(&bench->positions[index]);
+	}
+
+	sink += sum;
+
+	return bench->position_count;
+}
+
+static size_t run_parse_position(const struct bench *bench) {
+	struct position pos;
+	unsigned long sum = 0;
+	size_t index;
+
+	for (index = 0; index < bench->position_count; index++) {
+		parse_position(&pos, bench->fens[index]);
+		sum += (unsigned long)pos.key;
+	}
+
+	sink += sum;
+
+	return bench->position_count;
+}
+
+static const struct primitive primitives[] = {
+	{ "generate_pseudo_legal_moves", run_pseudo_legal },
+	{ "generate_legal_moves", run_legal },
+	{ "is_legal", run_is_legal },
+	{ "do_move", run_do_move },
+	{ "generate_quiet_checks", run_quiet_checks },
+	{ "gives_check", run_gives_check },
+	{ "evaluate", run_evaluate },
+	{ "parse_position", run_parse_position },
+	{ NULL, NULL }
+};
+
+/* time the primitive over all positions and write the results.              */
+static void run_primitive(const struct bench *bench, const struct primitive *primitive, double *times) {
+	size_t ops = 0;
+	double mean = 0;
+	double variance = 0;
+	double min = 0;
+	int run;
+
+	for (run = 0; run < bench->warmup; run++) {
+		primitive->run(bench);
+	}
+
+	for (run = 0; run < bench->runs; run++) {
+		double start = get_time();
+
+		ops = primitive->run(bench);
+		times[run] = (get_time() - start) * 1e9 / (ops ? ops : 1);
+		mean += times[run] / bench->runs;
+
+		if (run == 0 || times[run] < min) {
+			min = times[run];
+		}
+	}
+
+	for (run = 0; run < bench->runs; run++) {
+		variance += (times[run] - mean) * (times[run] - mean) / bench->runs;
+	}
+
+	fprintf(stderr, "%-28s %10lu ops %10.2f ns/op %12.0f ops/s %8.2f stddev %10.2f min\n", primitive->name, (unsigned long)ops, mean, 1e9 / mean, sqrt(variance), min);
+	printf("{\"name\":\"%s\",\"positions\":%lu,\"ops\":%lu,\"runs\":%d,\"ns_per_op\":%.2f,\"ops_per_sec\":%.0f,\"stddev_ns\":%.2f,\"min_ns\":%.2f}\n", primitive->name, bench->position_count, (unsigned long)ops, bench->runs, mean, 1e9 / mean, sqrt(variance), min);
+	fflush(stdout);
+}
+
+/* pin the benchmark to one processor, so it is not moved between caches     */
+/* and frequency domains while it runs.                                      */
+static void pin_cpu(struct bench *bench) {
+#ifdef __linux__
+	cpu_set_t set;
+
+	if (bench->cpu == -2) {
+		bench->cpu = sched_getcpu();
+	}
+
+	if (bench->cpu < 0) {
+		return;
+	}
+
+	CPU_ZERO(&set);
+	CPU_SET(bench->cpu, &set);
+
+	if (sched_setaffinity(0, sizeof set, &set) != 0) {
+		fprintf(stderr, "microbench: could not pin to cpu %d\n", bench->cpu);
+		bench->cpu = -1;
+	}
+#else
+	bench->cpu = -1;
+#endif
+}
+
+static int parse_options(struct bench *bench, int argc, char **argv) {
+	int index;
+
+	bench->position_count = 10000;
+	bench->runs = 10;
+	bench->warmup = 2;
+	bench->seed = 1;
+
+	/* -2 stands for the processor we start on, which `pin_cpu` looks up.    */
+	bench->cpu = -2;
+	bench->input = NULL;
+
+	for (index = 0; index < argc && argv[index][0] == '-'; index += 2) {
+		const char *option = argv[index];
+		const char *value = index + 1 < argc ? argv[index + 1] : NULL;
+
+		if (!value) {
+			return FAILURE;
+		} else if (!strcmp(option, "-positions")) {
+			bench->position_count = strtoul(value, NULL, 10);
+		} else if (!strcmp(option, "-runs")) {
+			bench->runs = atoi(value);
+		} else if (!strcmp(option, "-warmup")) {
+			bench->warmup = atoi(value);
+		} else if (!strcmp(option, "-seed")) {
+			bench->seed = strtoul(value, NULL, 10);
+		} else if (!strcmp(option, "-cpu")) {
+			bench->cpu = atoi(value);
+
+			if (bench->cpu < -1) {
+				return FAILURE;
+			}
+		} else {
+			return FAILURE;
+		}
+	}
+
+	if (argc - index > 1 || bench->position_count < 1 || bench->runs < 1 || bench->warmup < 0) {
+		return FAILURE;
+	}
+
+	if (index < argc && !(bench->input = fopen(argv[index], "r"))) {
+		fprintf(stderr, "microbench: could not open %s\n", argv[index]);
+
+		return FAILURE;
+	}
+
+	return SUCCESS;
+}
+
+int microbench_run(int argc, char **argv) {
+	struct bench bench;
+	const struct primitive *primitive;
+	double *times;
+	int result = SUCCESS;
+
+	if (parse_options(&bench, argc, argv) != SUCCESS) {
+		fprintf(stderr, "usage: microbench [-positions n] [-runs n] [-warmup n] [-seed n] [-cpu n] [file]\n");
+
+		return FAILURE;
+	}
+
+	bench.positions = malloc(bench.position_count * sizeof *bench.positions);
+	bench.fens = NULL;
+	bench.pseudo_legal_moves = NULL;
+	bench.legal_moves = NULL;
+	times = malloc(bench.runs * sizeof *times);
+
+	if (!bench.positions || !times) {
+		result = FAILURE;
+	} else if (bench.input) {
+		bench.position_count = read_positions(&bench);
+		fclose(bench.input);
+	} else {
+		play_positions(&bench);
+	}
+
+	if (result == SUCCESS && (bench.position_count == 0 || prepare(&bench) != SUCCESS)) {
+		result = FAILURE;
+	}
+
+	if (result == SUCCESS) {
+		pin_cpu(&bench);
+		fprintf(stderr, "%lu positions, %lu pseudo legal moves, %lu legal moves, %d runs, cpu %d, kernels %s\n", bench.position_count, (unsigned long)bench.pseudo_legal_count, (unsigned long)bench.legal_count, bench.runs, bench.cpu, cpu_description());
+
+		for (primitive = primitives; primitive->name; primitive++) {
+			run_primitive(&bench, primitive, times);
+		}
+	} else {
+		fprintf(stderr, "microbench: no positions, or out of memory\n");
+	}
+
+	free(bench.positions);
+	free(bench.fens);
+	free(bench.pseudo_legal_moves);
+	free(bench.legal_moves);
+	free(times);
+
+	return result;
+}
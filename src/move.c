@@ -1,7 +1,13 @@
 #include "move.h"
 #include "generate.h"
 #include "parse.h"
+#include "profile.h"
+#include "tables.h"
 #include "types.h"
+#include "zobrist.h"
+
+#include <ctype.h>
+#include <string.h>
 
 struct move make_move(int from_square, int to_square, int promotion_type) {
 	struct move move;
@@ -42,118 +48,261 @@ int parse_move(struct move *move, const char *string) {
 	return SUCCESS;
 }
 
-void do_move(struct position *pos, struct move move) {
-	int from_file = FILE(move.from_square);
-	int from_rank = RANK(move.from_square);
-	int to_file = FILE(move.to_square);
-	int to_rank = RANK(move.to_square);
-	int piece = pos->board[move.from_square];
-	int color = pos->side_to_move;
-	int a1 = SQUARE(FILE_A, RELATIVE(RANK_1, color));
-	int h1 = SQUARE(FILE_H, RELATIVE(RANK_1, color));
-	int a8 = SQUARE(FILE_A, RELATIVE(RANK_8, color));
-	int h8 = SQUARE(FILE_H, RELATIVE(RANK_8, color));
-	int en_passant_square = pos->en_passant_square;
+void format_move(char *buffer, struct move move) {
+	if (move.from_square == NO_SQUARE) {
+		strcpy(buffer, "0000");
+
+		return;
+	}
 
-	/* move the piece, promoting it if necessary.                            */
-	pos->board[move.from_square] = NO_PIECE;
+	*buffer++ = "abcdefgh"[FILE(move.from_square)];
+	*buffer++ = '1' + RANK(move.from_square);
+	*buffer++ = "abcdefgh"[FILE(move.to_square)];
+	*buffer++ = '1' + RANK(move.to_square);
 
 	if (move.promotion_type != NO_TYPE) {
-		pos->board[move.to_square] = PIECE(color, move.promotion_type);
-	} else {
-		pos->board[move.to_square] = piece;
+		*buffer++ = "pnbrqk"[move.promotion_type];
 	}
 
-	/* reset the en passant square.                                          */
-	pos->en_passant_square = NO_SQUARE;
+	*buffer = '\0';
+}
 
-	/* update castling rights.                                               */
-	if (move.from_square == h1) {
-		pos->castling_rights[color] &= ~KING_SIDE;
-	} else if (move.from_square == a1) {
-		pos->castling_rights[color] &= ~QUEEN_SIDE;
+int parse_san(struct move *move, const struct position *pos, const char *string) {
+	struct move moves[MAX_MOVES];
+	size_t count;
+	size_t index;
+	char buffer[8];
+	size_t length = 0;
+	int type = PAWN;
+	int promotion_type = NO_TYPE;
+	int from_file = NO_FILE;
+	int from_rank = NO_RANK;
+	int to_square = NO_SQUARE;
+	int found = 0;
+
+	/* castling, written with either letters or digits.                      */
+	if (!strncmp(string, "O-O-O", 5) || !strncmp(string, "0-0-0", 5)) {
+		type = KING;
+		from_file = FILE_E;
+		to_square = SQUARE(FILE_C, RELATIVE(RANK_1, pos->side_to_move));
+		string += 5;
+	} else if (!strncmp(string, "O-O", 3) || !strncmp(string, "0-0", 3)) {
+		type = KING;
+		from_file = FILE_E;
+		to_square = SQUARE(FILE_G, RELATIVE(RANK_1, pos->side_to_move));
+		string += 3;
+	} else if (*string && strchr("NBRQK", *string)) {
+		type = parse_type(tolower((unsigned char)*string++));
 	}
 
-	if (move.to_square == h8) {
-		pos->castling_rights[1 - color] &= ~KING_SIDE;
-	} else if (move.to_square == a8) {
-		pos->castling_rights[1 - color] &= ~QUEEN_SIDE;
+	/* keep only files, ranks, and promotion pieces.                         */
+	for (; *string; string++) {
+		if (strchr("abcdefgh12345678NBRQ", *string)) {
+			if (length == sizeof buffer) {
+				return FAILURE;
+			}
+
+			buffer[length++] = *string;
+		} else if (!strchr("x-=+#!?", *string)) {
+			return FAILURE;
+		}
 	}
 
-	/* update side to move.                                                  */
-	pos->side_to_move = 1 - color;
+	/* the to square comes last, optionally followed by a promotion type.    */
+	if (to_square == NO_SQUARE) {
+		if (length > 0 && strchr("NBRQ", buffer[length - 1])) {
+			promotion_type = parse_type(tolower((unsigned char)buffer[--length]));
+		}
+
+		if (length < 2) {
+			return FAILURE;
+		}
+
+		to_square = parse_square(buffer + length - 2);
+		length -= 2;
 
-	switch (TYPE(piece)) {
-	case PAWN:
-		/* set the en passant square for double pawn pushes.                 */
-		if (RELATIVE(to_rank, color) - RELATIVE(from_rank, color) == 2) {
-			pos->en_passant_square = SQUARE(to_file, RELATIVE(RANK_3, color));
+		if (to_square == NO_SQUARE) {
+			return FAILURE;
 		}
+	}
 
-		/* also remove the captured pawn for en passant captures.            */
-		if (move.to_square == en_passant_square) {
-			pos->board[SQUARE(to_file, from_rank)] = NO_PIECE;
+	/* anything left in front of it disambiguates the from square.           */
+	for (index = 0; index < length; index++) {
+		if (parse_file(buffer[index]) != NO_FILE) {
+			from_file = parse_file(buffer[index]);
+		} else if (parse_rank(buffer[index]) != NO_RANK) {
+			from_rank = parse_rank(buffer[index]);
+		} else {
+			return FAILURE;
 		}
+	}
 
-		break;
+	count = generate_legal_moves(pos, moves);
 
-	case KING:
-		/* update castling rights for king moves.                            */
-		pos->castling_rights[color] = 0;
+	for (index = 0; index < count; index++) {
+		if (pos->board[moves[index].from_square] != PIECE(pos->side_to_move, type)) {
+			continue;
+		}
 
-		/* also move the rook for castling moves.                            */
-		if (from_file == FILE_E && to_file == FILE_G) {
-			pos->board[SQUARE(FILE_H, to_rank)] = NO_PIECE;
-			pos->board[SQUARE(FILE_F, to_rank)] = PIECE(color, ROOK);
-		} else if (from_file == FILE_E && to_file == FILE_C) {
-			pos->board[SQUARE(FILE_A, to_rank)] = NO_PIECE;
-			pos->board[SQUARE(FILE_D, to_rank)] = PIECE(color, ROOK);
+		if (moves[index].to_square != to_square || moves[index].promotion_type != promotion_type) {
+			continue;
 		}
 
-		break;
+		if (from_file != NO_FILE && FILE(moves[index].from_square) != from_file) {
+			continue;
+		}
+
+		if (from_rank != NO_RANK && RANK(moves[index].from_square) != from_rank) {
+			continue;
+		}
+
+		*move = moves[index];
+		found++;
+	}
+
+	return found == 1 ? SUCCESS : FAILURE;
+}
+
+/* instantiate `do_move` once for each color.                                */
+#define US WHITE
+#define THEM BLACK
+#define SPECIALIZE(name) name##_white
+#include "move_color.h"
+#undef US
+#undef THEM
+#undef SPECIALIZE
+
+#define US BLACK
+#define THEM WHITE
+#define SPECIALIZE(name) name##_black
+#include "move_color.h"
+#undef US
+#undef THEM
+#undef SPECIALIZE
+
+void do_move(struct position *pos, struct move move) {
+	PROFILE_BEGIN(PROFILE_DO_MOVE);
+
+	if (pos->side_to_move == WHITE) {
+		do_move_white(pos, move);
+	} else {
+		do_move_black(pos, move);
 	}
+
+	PROFILE_END(PROFILE_DO_MOVE);
 }
 
+void do_null_move(struct position *pos) {
+	pos->key ^= zobrist_en_passant(pos) ^ ZOBRIST_TURN;
+	pos->en_passant_square = NO_SQUARE;
+	pos->side_to_move = 1 - pos->side_to_move;
+	pos->halfmove_clock++;
+}
+
+/* returns true if the piece on the from square is pinned to the king by an  */
+/* opponent slider, and the move takes it off the line between them.         */
+static int breaks_pin(const struct position *pos, struct move move, int king) {
+	int direction;
+	int diagonal;
+	int piece;
+	const signed char *ray;
+
+	/* a piece that the opponent does not attack can not be pinned.          */
+	if (!ATTACKED_BY(pos, move.from_square, 1 - pos->side_to_move)) {
+		return 0;
+	}
+
+	direction = line_direction(king, move.from_square);
+
+	if (direction < 0) {
+		return 0;
+	}
+
+	diagonal = direction == 0 || direction == 2 || direction == 5 || direction == 7;
+
+	/* the piece must be the first one on the ray from the king, and an      */
+	/* opponent piece that moves along the ray the first one after it.       */
+	for (ray = rays[king][direction]; *ray != move.from_square; ray++) {
+		if (pos->board[*ray] != NO_PIECE) {
+			return 0;
+		}
+	}
+
+	for (ray++; *ray != NO_SQUARE && pos->board[*ray] == NO_PIECE; ray++) {
+	}
+
+	if (*ray == NO_SQUARE) {
+		return 0;
+	}
+
+	piece = pos->board[*ray];
+
+	if (COLOR(piece) == pos->side_to_move || (TYPE(piece) != QUEEN && TYPE(piece) != (diagonal ? BISHOP : ROOK))) {
+		return 0;
+	}
+
+	return !(ray_masks[king][direction] >> move.to_square & 1);
+}
 
 int is_legal(const struct position *pos, struct move move) {
-	struct position copy = *pos;
-	struct move moves[MAX_MOVES];
+	struct position copy;
+	int color = pos->side_to_move;
 	int piece = pos->board[move.from_square];
-	size_t count;
-	size_t index;
+	int king = NO_SQUARE;
+	int index;
+	int check;
+	int legal = -1;
 
-	/* make the move on a copy of the position.                              */
-	do_move(&copy, move);
+	PROFILE_BEGIN(PROFILE_LEGAL);
 
-	/* for castling moves, pretend there is another king on all squares      */
-	/* between the from square and the to square. this makes it illegal to   */
-	/* castle through a square that is controlled by the opponent.           */
-	if (TYPE(piece) == KING) {
-		int from_file = FILE(move.from_square);
-		int to_file = FILE(move.to_square);
-		int rank = RELATIVE(RANK_1, pos->side_to_move);
-
-		if (from_file == FILE_E && to_file == FILE_G) {
-			copy.board[SQUARE(FILE_E, rank)] = piece;
-			copy.board[SQUARE(FILE_F, rank)] = piece;
-		} else if (from_file == FILE_E && to_file == FILE_C) {
-			copy.board[SQUARE(FILE_E, rank)] = piece;
-			copy.board[SQUARE(FILE_D, rank)] = piece;
+	for (index = 0; index < pos->piece_count[color]; index++) {
+		if (pos->board[pos->pieces[color][index]] == PIECE(color, KING)) {
+			king = pos->pieces[color][index];
 		}
 	}
 
-	/* generate all pseudo-legal moves for the opponent.                     */
-	count = generate_pseudo_legal_moves(&copy, moves);
+	check = king != NO_SQUARE && ATTACKED_BY(pos, king, 1 - color);
 
-	/* return false if any of those moves could capture the king.            */
-	for (index = 0; index < count; index++) {
-		int piece = copy.board[moves[index].to_square];
-
-		if (piece == PIECE(pos->side_to_move, KING)) {
-			return 0;
+	if (king == NO_SQUARE) {
+		/* without a king, nothing can be illegal.                           */
+		legal = 1;
+	} else if (TYPE(piece) == KING) {
+		int from_file = FILE(move.from_square);
+		int to_file = FILE(move.to_square);
+		int rank = RANK(move.from_square);
+
+		/* castling out of check or through a square that is controlled by   */
+		/* the opponent is not allowed, and the king can not move to an      */
+		/* attacked square. when the king is in check, the squares behind it */
+		/* on the ray of the checking slider look safe, so they need the     */
+		/* full test.                                                        */
+		if (from_file == FILE_E && to_file == FILE_G && (check || ATTACKED_BY(pos, SQUARE(FILE_F, rank), 1 - color))) {
+			legal = 0;
+		} else if (from_file == FILE_E && to_file == FILE_C && (check || ATTACKED_BY(pos, SQUARE(FILE_D, rank), 1 - color))) {
+			legal = 0;
+		} else if (ATTACKED_BY(pos, move.to_square, 1 - color)) {
+			legal = 0;
+		} else if (!check) {
+			legal = 1;
 		}
+
+		king = move.to_square;
+	} else if (!check && !(TYPE(piece) == PAWN && move.to_square == pos->en_passant_square)) {
+		/* when the king is not in check, only a pinned piece can expose it. */
+		/* en passant also removes the captured pawn, which can be pinned    */
+		/* too, so it gets the full test.                                    */
+		legal = !breaks_pin(pos, move, king);
 	}
 
-	/* return true if no moves could capture the king.                       */
-	return 1;
-}
\ No newline at end of file
+	/* otherwise make the move on a copy of the position, and check whether  */
+	/* the opponent attacks our king there.                                  */
+	if (legal == -1) {
+		copy = *pos;
+		do_move(&copy, move);
+		legal = !ATTACKED_BY(&copy, king, 1 - color);
+	}
+
+	PROFILE_END(PROFILE_LEGAL);
+
+	return legal;
+}
@@ -0,0 +1,131 @@
+/* making a move for one color. this file is included twice by `move.c`,     */
+/* once for each color, with `US` and `THEM` defined as `WHITE` and `BLACK`  */
+/* or the other way around, and `SPECIALIZE(name)` adding a color suffix to  */
+/* the function name. since the color is a constant, the compiler can fold   */
+/* the castling squares and the en passant rank.                             */
+
+static void SPECIALIZE(do_move)(struct position *pos, struct move move) {
+	int from_file = FILE(move.from_square);
+	int from_rank = RANK(move.from_square);
+	int to_file = FILE(move.to_square);
+	int to_rank = RANK(move.to_square);
+	int piece = pos->board[move.from_square];
+	int captured = pos->board[move.to_square];
+	int a1 = SQUARE(FILE_A, RELATIVE(RANK_1, US));
+	int h1 = SQUARE(FILE_H, RELATIVE(RANK_1, US));
+	int a8 = SQUARE(FILE_A, RELATIVE(RANK_8, US));
+	int h8 = SQUARE(FILE_H, RELATIVE(RANK_8, US));
+	int en_passant_square = pos->en_passant_square;
+
+	/* the squares that were emptied or filled, and whether a slider of ours */
+	/* moved or appeared, for updating the attacks.                          */
+	uint64_t touched = (uint64_t)1 << move.from_square | (uint64_t)1 << move.to_square;
+	int sliders_moved = SLIDER(TYPE(piece)) || (move.promotion_type != NO_TYPE && SLIDER(move.promotion_type));
+
+	/* remove the castling rights and en passant file from the key, they are */
+	/* added back once the move is done. the side to move always changes.    */
+	uint64_t key = pos->key ^ zobrist_castling(pos) ^ zobrist_en_passant(pos) ^ ZOBRIST_TURN;
+
+	/* move the piece, promoting it if necessary.                            */
+	key ^= ZOBRIST_PIECE(piece, move.from_square);
+
+	if (captured != NO_PIECE) {
+		remove_piece(pos, move.to_square);
+		key ^= ZOBRIST_PIECE(captured, move.to_square);
+	}
+
+	move_piece(pos, move.from_square, move.to_square);
+
+	if (move.promotion_type != NO_TYPE) {
+		pos->board[move.to_square] = PIECE(US, move.promotion_type);
+	}
+
+	key ^= ZOBRIST_PIECE(pos->board[move.to_square], move.to_square);
+
+	/* reset the en passant square.                                          */
+	pos->en_passant_square = NO_SQUARE;
+
+	/* update castling rights.                                               */
+	if (move.from_square == h1) {
+		pos->castling_rights[US] &= ~KING_SIDE;
+	} else if (move.from_square == a1) {
+		pos->castling_rights[US] &= ~QUEEN_SIDE;
+	}
+
+	if (move.to_square == h8) {
+		pos->castling_rights[THEM] &= ~KING_SIDE;
+	} else if (move.to_square == a8) {
+		pos->castling_rights[THEM] &= ~QUEEN_SIDE;
+	}
+
+	/* update side to move.                                                  */
+	pos->side_to_move = THEM;
+
+	/* captures and pawn moves reset the halfmove clock.                     */
+	if (captured != NO_PIECE || TYPE(piece) == PAWN) {
+		pos->halfmove_clock = 0;
+	} else {
+		pos->halfmove_clock++;
+	}
+
+	switch (TYPE(piece)) {
+	case PAWN:
+		/* set the en passant square for double pawn pushes.                 */
+		if (RELATIVE(to_rank, US) - RELATIVE(from_rank, US) == 2) {
+			pos->en_passant_square = SQUARE(to_file, RELATIVE(RANK_3, US));
+		}
+
+		/* also remove the captured pawn for en passant captures.            */
+		if (move.to_square == en_passant_square) {
+			remove_piece(pos, SQUARE(to_file, from_rank));
+			touched |= (uint64_t)1 << SQUARE(to_file, from_rank);
+			captured = PIECE(THEM, PAWN);
+			key ^= ZOBRIST_PIECE(PIECE(THEM, PAWN), SQUARE(to_file, from_rank));
+		}
+
+		break;
+
+	case KING:
+		/* update castling rights for king moves.                            */
+		pos->castling_rights[US] = 0;
+
+		/* also move the rook for castling moves.                            */
+		if (from_file == FILE_E && to_file == FILE_G) {
+			move_piece(pos, SQUARE(FILE_H, to_rank), SQUARE(FILE_F, to_rank));
+			touched |= (uint64_t)1 << SQUARE(FILE_H, to_rank) | (uint64_t)1 << SQUARE(FILE_F, to_rank);
+			sliders_moved = 1;
+			key ^= ZOBRIST_PIECE(PIECE(US, ROOK), SQUARE(FILE_H, to_rank));
+			key ^= ZOBRIST_PIECE(PIECE(US, ROOK), SQUARE(FILE_F, to_rank));
+		} else if (from_file == FILE_E && to_file == FILE_C) {
+			move_piece(pos, SQUARE(FILE_A, to_rank), SQUARE(FILE_D, to_rank));
+			touched |= (uint64_t)1 << SQUARE(FILE_A, to_rank) | (uint64_t)1 << SQUARE(FILE_D, to_rank);
+			sliders_moved = 1;
+			key ^= ZOBRIST_PIECE(PIECE(US, ROOK), SQUARE(FILE_A, to_rank));
+			key ^= ZOBRIST_PIECE(PIECE(US, ROOK), SQUARE(FILE_D, to_rank));
+		}
+
+		break;
+	}
+
+	pos->key = key ^ zobrist_castling(pos) ^ zobrist_en_passant(pos);
+
+	/* only the attacks of pieces that moved or were captured change, and    */
+	/* those of sliders with a ray through a touched square, which the old   */
+	/* attacks tell us. anything else keeps its attacks.                     */
+	if (!SLIDER(TYPE(piece))) {
+		update_leaper_attacks(pos, US);
+	}
+
+	if (sliders_moved || (pos->slider_attacks[US] & touched)) {
+		update_slider_attacks(pos, US);
+	}
+
+	if (captured != NO_PIECE && !SLIDER(TYPE(captured))) {
+		update_leaper_attacks(pos, THEM);
+	}
+
+	if ((captured != NO_PIECE && SLIDER(TYPE(captured))) || (pos->slider_attacks[THEM] & touched)) {
+		update_slider_attacks(pos, THEM);
+	}
+}
+
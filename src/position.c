@@ -1,7 +1,18 @@
 #include "position.h"
+#include "cpu.h"
 #include "parse.h"
+#include "tables.h"
+#include "zobrist.h"
 #include "types.h"
 
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if CPU_DISPATCH
+#include <immintrin.h>
+#endif
+
 void print_position(const struct position *pos, FILE *stream) {
 	char castling_rights_buffer[] = { '-', '\0', '\0', '\0', '\0' };
 	char en_passant_square_buffer[] = { '-', '\0', '\0' };
@@ -58,29 +69,278 @@ void print_position(const struct position *pos, FILE *stream) {
 	fprintf(stream, "side to move: %c\n", "wb"[pos->side_to_move]);
 	fprintf(stream, "castling rights: %s\n", castling_rights_buffer);
 	fprintf(stream, "en passant square: %s\n", en_passant_square_buffer);
+	fprintf(stream, "halfmove clock: %d\n", pos->halfmove_clock);
+}
+
+void clear_board(struct position *pos) {
+	memset(pos->board, NO_PIECE, sizeof pos->board);
+	pos->occupied = 0;
+	pos->piece_count[WHITE] = 0;
+	pos->piece_count[BLACK] = 0;
+}
+
+void put_piece(struct position *pos, int square, int piece) {
+	int color = COLOR(piece);
+
+	pos->board[square] = piece;
+	pos->occupied |= (uint64_t)1 << square;
+	pos->index[square] = pos->piece_count[color];
+	pos->pieces[color][pos->piece_count[color]++] = square;
+}
+
+void remove_piece(struct position *pos, int square) {
+	int color = COLOR(pos->board[square]);
+	int last = pos->pieces[color][--pos->piece_count[color]];
+
+	/* the last piece in the list takes the place of the removed one.        */
+	pos->pieces[color][pos->index[square]] = last;
+	pos->index[last] = pos->index[square];
+	pos->board[square] = NO_PIECE;
+	pos->occupied &= ~((uint64_t)1 << square);
+}
+
+void move_piece(struct position *pos, int from_square, int to_square) {
+	int color = COLOR(pos->board[from_square]);
+
+	pos->pieces[color][pos->index[from_square]] = to_square;
+	pos->index[to_square] = pos->index[from_square];
+	pos->board[to_square] = pos->board[from_square];
+	pos->board[from_square] = NO_PIECE;
+	pos->occupied ^= (uint64_t)1 << from_square | (uint64_t)1 << to_square;
+}
+
+void update_leaper_attacks(struct position *pos, int color) {
+	uint64_t attacks = 0;
+	int index;
+
+	for (index = 0; index < pos->piece_count[color]; index++) {
+		int square = pos->pieces[color][index];
+
+		switch (TYPE(pos->board[square])) {
+		case PAWN:
+			attacks |= pawn_attacks[color][square];
+			break;
+		case KNIGHT:
+			attacks |= knight_attacks[square];
+			break;
+		case KING:
+			attacks |= king_attacks[square];
+			break;
+		}
+	}
+
+	pos->leaper_attacks[color] = attacks;
+}
+
+/* directions 0 to 3 go to lower squares, so the first piece is the highest  */
+/* one on the ray, and directions 4 to 7 go to higher squares.               */
+uint64_t ray_attacks(uint64_t occupied, int square, int direction) {
+	uint64_t ray = ray_masks[square][direction];
+	uint64_t blockers = ray & occupied;
+	int blocker;
+
+	if (!blockers) {
+		return ray;
+	}
+
+#if defined(__GNUC__)
+	blocker = direction < 4 ? 63 - __builtin_clzll(blockers) : __builtin_ctzll(blockers);
+#else
+	for (blocker = direction < 4 ? 63 : 0; !(blockers >> blocker & 1); blocker += direction < 4 ? -1 : 1) {
+	}
+#endif
+
+	return ray ^ ray_masks[blocker][direction];
+}
+
+int line_direction(int square, int target) {
+	static const int directions[3][3] = { { 0, 1, 2 }, { 3, -1, 4 }, { 5, 6, 7 } };
+	int file_distance = FILE(target) - FILE(square);
+	int rank_distance = RANK(target) - RANK(square);
+
+	if ((file_distance != 0 && rank_distance != 0 && abs(file_distance) != abs(rank_distance)) || target == square) {
+		return -1;
+	}
+
+	return directions[(rank_distance > 0) - (rank_distance < 0) + 1][(file_distance > 0) - (file_distance < 0) + 1];
+}
+
+int lowest_square(uint64_t squares) {
+#if defined(__GNUC__)
+	return __builtin_ctzll(squares);
+#else
+	int square = 0;
+
+	for (; !(squares & 1); squares >>= 1) {
+		square++;
+	}
+
+	return square;
+#endif
+}
+
+/* compute the attacks of the bishops, rooks and queens of the color by      */
+/* scanning their rays.                                                      */
+static uint64_t slider_attacks_generic(const struct position *pos, int color) {
+	uint64_t attacks = 0;
+	int index;
+
+	for (index = 0; index < pos->piece_count[color]; index++) {
+		int square = pos->pieces[color][index];
+		int type = TYPE(pos->board[square]);
+
+		/* the diagonals are at indices 0, 2, 5 and 7.                       */
+		if (type == BISHOP || type == QUEEN) {
+			attacks |= ray_attacks(pos->occupied, square, 0);
+			attacks |= ray_attacks(pos->occupied, square, 2);
+			attacks |= ray_attacks(pos->occupied, square, 5);
+			attacks |= ray_attacks(pos->occupied, square, 7);
+		}
+
+		if (type == ROOK || type == QUEEN) {
+			attacks |= ray_attacks(pos->occupied, square, 1);
+			attacks |= ray_attacks(pos->occupied, square, 3);
+			attacks |= ray_attacks(pos->occupied, square, 4);
+			attacks |= ray_attacks(pos->occupied, square, 6);
+		}
+	}
+
+	return attacks;
+}
+
+#if CPU_DISPATCH
+/* the attacks of a bishop or rook on a square, for every occupancy of the   */
+/* squares its rays go through, not counting the last square of each ray     */
+/* since a piece there blocks nothing. `pext` packs the bits of those        */
+/* squares into an index into `attacks`. a rook on a corner has 12 such      */
+/* squares, so all tables together take 107648 entries, or 841 KB.           */
+struct slider_table {
+	uint64_t mask;
+	uint64_t *attacks;
+};
+
+#define SLIDER_ENTRIES 107648
+
+static struct slider_table bishop_tables[64];
+static struct slider_table rook_tables[64];
+static uint64_t slider_entries[SLIDER_ENTRIES];
+
+/* fill in the tables of the slider moving in the four directions from every */
+/* square, starting at `entries`. returns the entries that follow them.      */
+static __attribute__((target("bmi2"))) uint64_t *init_slider_table(struct slider_table *tables, const int *directions, uint64_t *entries) {
+	int square;
+	int index;
+
+	for (square = 0; square < 64; square++) {
+		uint64_t mask = 0;
+		uint64_t occupied = 0;
+
+		for (index = 0; index < 4; index++) {
+			uint64_t ray = ray_masks[square][directions[index]];
+
+			/* the last square of a ray is the one with nothing after it.    */
+			if (ray) {
+				int last = directions[index] < 4 ? __builtin_ctzll(ray) : 63 - __builtin_clzll(ray);
+
+				mask |= ray & ~((uint64_t)1 << last);
+			}
+		}
+
+		tables[square].mask = mask;
+		tables[square].attacks = entries;
+
+		/* visit every subset of the mask, see                               */
+		/* https://www.chessprogramming.org/Traversing_Subsets_of_a_Set      */
+		do {
+			uint64_t attacks = 0;
+
+			for (index = 0; index < 4; index++) {
+				attacks |= ray_attacks(occupied, square, directions[index]);
+			}
+
+			entries[_pext_u64(occupied, mask)] = attacks;
+			occupied = (occupied - mask) & mask;
+		} while (occupied);
+
+		entries += (size_t)1 << __builtin_popcountll(mask);
+	}
+
+	return entries;
+}
+
+static void init_slider_tables(void) {
+	static const int diagonals[4] = { 0, 2, 5, 7 };
+	static const int lines[4] = { 1, 3, 4, 6 };
+
+	init_slider_table(rook_tables, lines, init_slider_table(bishop_tables, diagonals, slider_entries));
+}
+
+/* compute the attacks of the bishops, rooks and queens of the color with    */
+/* one table lookup per slider and direction kind.                           */
+static __attribute__((target("bmi2"))) uint64_t slider_attacks_bmi2(const struct position *pos, int color) {
+	uint64_t attacks = 0;
+	int index;
+
+	for (index = 0; index < pos->piece_count[color]; index++) {
+		int square = pos->pieces[color][index];
+		int type = TYPE(pos->board[square]);
+
+		if (type == BISHOP || type == QUEEN) {
+			attacks |= bishop_tables[square].attacks[_pext_u64(pos->occupied, bishop_tables[square].mask)];
+		}
+
+		if (type == ROOK || type == QUEEN) {
+			attacks |= rook_tables[square].attacks[_pext_u64(pos->occupied, rook_tables[square].mask)];
+		}
+	}
+
+	return attacks;
+}
+#endif
+
+/* the slider attack kernel picked by `init_slider_attacks`.                 */
+static uint64_t (*slider_attacks)(const struct position *pos, int color) = slider_attacks_generic;
+static pthread_once_t slider_once = PTHREAD_ONCE_INIT;
+
+static void init_slider_attacks(void) {
+#if CPU_DISPATCH
+	if (cpu_features() & CPU_BMI2) {
+		init_slider_tables();
+		slider_attacks = slider_attacks_bmi2;
+	}
+#endif
+}
+
+void update_slider_attacks(struct position *pos, int color) {
+	pos->slider_attacks[color] = slider_attacks(pos, color);
+}
+
+void update_attacks(struct position *pos) {
+	pthread_once(&slider_once, init_slider_attacks);
+	update_leaper_attacks(pos, WHITE);
+	update_leaper_attacks(pos, BLACK);
+	update_slider_attacks(pos, WHITE);
+	update_slider_attacks(pos, BLACK);
 }
 
 int parse_position(struct position *pos, const char *fen) {
 	int file;
 	int rank;
-	int square;
 	int index;
 
 	/* initialize an empty board.                                            */
-	for (square = 0; square < 64; square++) {
-		pos->board[square] = NO_PIECE;
-	}
+	clear_board(pos);
 
 	/* parse piece placement.                                                */
 	for (file = 0, rank = 7; file < 8 || rank > 0; fen++) {
 		int piece = parse_piece(*fen);
 
 		if (piece != NO_PIECE) {
-			if (file >= 8) {
+			if (file >= 8 || pos->piece_count[COLOR(piece)] == 16) {
 				return FAILURE;
 			}
 
-			pos->board[SQUARE(file, rank)] = piece;
+			put_piece(pos, SQUARE(file, rank), piece);
 			file++;
 		} else if (*fen >= '1' && *fen <= '8') {
 			file += *fen - '0';
@@ -164,7 +424,9 @@ int parse_position(struct position *pos, const char *fen) {
 		return FAILURE;
 	}
 
-	/* ignore halfmove clock and fullmove counter.                           */
+	/* parse the halfmove clock, and ignore the fullmove counter.            */
+	pos->halfmove_clock = 0;
+
 	for (index = 0; index < 2; index++) {
 		if (*fen++ != ' ') {
 			return FAILURE;
@@ -175,6 +437,10 @@ int parse_position(struct position *pos, const char *fen) {
 		}
 
 		while (*fen >= '0' && *fen <= '9') {
+			if (index == 0 && pos->halfmove_clock < 1000) {
+				pos->halfmove_clock = pos->halfmove_clock * 10 + *fen - '0';
+			}
+
 			fen++;
 		}
 	}
@@ -184,5 +450,97 @@ int parse_position(struct position *pos, const char *fen) {
 		return FAILURE;
 	}
 
+	pos->key = zobrist_key(pos);
+	update_attacks(pos);
+
+	return SUCCESS;
+}
+
+void history_push(struct history *history, const struct position *pos) {
+	if (history->count == HISTORY_SIZE) {
+		memmove(history->keys, history->keys + HISTORY_SIZE / 2, HISTORY_SIZE / 2 * sizeof *history->keys);
+		history->count = HISTORY_SIZE / 2;
+	}
+
+	history->keys[history->count++] = pos->key;
+}
+
+void history_pop(struct history *history) {
+	history->count--;
+}
+
+int is_draw(const struct history *history, const struct position *pos) {
+	int distance;
+
+	if (pos->halfmove_clock >= 100) {
+		return 1;
+	}
+
+	/* it takes at least four plies to get back to the same position.        */
+	for (distance = 4; distance <= pos->halfmove_clock && distance <= history->count; distance += 2) {
+		if (history->keys[history->count - distance] == pos->key) {
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+int epd_to_fen(char *fen, size_t size, const char *line) {
+	const char *fields[6];
+	size_t lengths[6];
+	size_t length = 0;
+	int count = 0;
+	int index;
+
+	while (count < 6) {
+		while (*line == ' ' || *line == '\t') {
+			line++;
+		}
+
+		if (!*line || *line == '\n' || *line == '\r') {
+			break;
+		}
+
+		fields[count] = line;
+
+		while (*line && *line != ' ' && *line != '\t' && *line != '\n' && *line != '\r') {
+			line++;
+		}
+
+		lengths[count] = line - fields[count];
+		count++;
+	}
+
+	if (count < 4) {
+		return FAILURE;
+	}
+
+	/* the clocks are only there if both fields are numbers.                 */
+	if (count == 6 && strspn(fields[4], "0123456789") == lengths[4] && strspn(fields[5], "0123456789") == lengths[5]) {
+		count = 6;
+	} else {
+		count = 4;
+	}
+
+	/* the fields, a space after all but the last, and the terminator.       */
+	for (index = 0; index < count; index++) {
+		length += lengths[index] + 1;
+	}
+
+	if (length + (count == 4 ? 4 : 0) > size) {
+		return FAILURE;
+	}
+
+	for (index = 0; index < count; index++) {
+		memcpy(fen, fields[index], lengths[index]);
+		fen += lengths[index];
+		*fen++ = index + 1 < count ? ' ' : '\0';
+	}
+
+	if (count == 4) {
+		strcpy(fen - 1, " 0 1");
+	}
+
 	return SUCCESS;
 }
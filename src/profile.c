@@ -0,0 +1,83 @@
+#include "profile.h"
+
+#include <pthread.h>
+#include <string.h>
+#include <time.h>
+
+static const char *counter_names[PROFILE_COUNTERS] = { "search", "generate", "is_legal", "do_move", "evaluate" };
+
+static pthread_mutex_t totals_mutex = PTHREAD_MUTEX_INITIALIZER;
+static uint64_t total_calls[PROFILE_COUNTERS];
+static uint64_t total_ticks[PROFILE_COUNTERS];
+static uint64_t total_nodes;
+
+#if PROFILE
+__thread struct profile_timer profile_timers[PROFILE_COUNTERS];
+
+uint64_t profile_clock(void) {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+#endif
+
+void profile_flush(uint64_t nodes) {
+	pthread_mutex_lock(&totals_mutex);
+
+#if PROFILE
+	{
+		int counter;
+
+		for (counter = 0; counter < PROFILE_COUNTERS; counter++) {
+			total_calls[counter] += profile_timers[counter].calls;
+			total_ticks[counter] += profile_timers[counter].ticks;
+			profile_timers[counter].calls = 0;
+			profile_timers[counter].ticks = 0;
+		}
+	}
+#endif
+
+	total_nodes += nodes;
+	pthread_mutex_unlock(&totals_mutex);
+}
+
+void profile_reset(void) {
+	profile_flush(0);
+	pthread_mutex_lock(&totals_mutex);
+	memset(total_calls, 0, sizeof total_calls);
+	memset(total_ticks, 0, sizeof total_ticks);
+	total_nodes = 0;
+	pthread_mutex_unlock(&totals_mutex);
+}
+
+void profile_report(FILE *stream, const char *prefix) {
+	const char *unit = "ns";
+	int counter;
+
+	if (!PROFILE) {
+		fprintf(stream, "%sprofiling is not compiled in, build with -DPROFILE=1\n", prefix);
+
+		return;
+	}
+
+#if defined(__x86_64__) || defined(__i386__)
+	unit = "cycles";
+#endif
+
+	/* the counters of this thread are not flushed by a search.              */
+	profile_flush(0);
+	pthread_mutex_lock(&totals_mutex);
+	fprintf(stream, "%sprofile in %s, nested calls included\n", prefix, unit);
+
+	for (counter = 0; counter < PROFILE_COUNTERS; counter++) {
+		double per_call = total_calls[counter] ? (double)total_ticks[counter] / total_calls[counter] : 0;
+		double share = total_ticks[PROFILE_SEARCH] ? 100.0 * total_ticks[counter] / total_ticks[PROFILE_SEARCH] : 0;
+
+		fprintf(stream, "%s%-8s calls %lu %s %lu per call %.1f search %.1f%%\n", prefix, counter_names[counter], (unsigned long)total_calls[counter], unit, (unsigned long)total_ticks[counter], per_call, share);
+	}
+
+	fprintf(stream, "%snodes %lu %s per node %.1f\n", prefix, (unsigned long)total_nodes, unit, total_nodes ? (double)total_ticks[PROFILE_SEARCH] / total_nodes : 0);
+	pthread_mutex_unlock(&totals_mutex);
+}
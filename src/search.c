@@ -1,45 +1,1021 @@
+#define _POSIX_C_SOURCE 200112L
+
 #include "search.h"
 #include "evaluate.h"
 #include "generate.h"
+#include "profile.h"
+#include "see.h"
+#include "tablebase.h"
+#include "types.h"
+#include "uci.h"
 
-#include <limits.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
 
-struct search_result minimax(const struct position *pos, int depth) {
-	struct search_result result;
+/* the score of a position that the tablebases say is won, larger than any   */
+/* evaluation but smaller than any mate.                                     */
+#define TABLEBASE_SCORE 500000
+
+/* a score outside the range of all other scores, for the initial bounds.    */
+#define INFINITE_SCORE (2 * MATE_SCORE)
+
+/* the depth searched when no limits are given.                              */
+#define DEFAULT_DEPTH 4
+
+/* the smallest depth where null moves are tried, and the smallest depth     */
+/* where a null move that fails high is verified.                            */
+#define NULL_MOVE_DEPTH 3
+#define NULL_MOVE_VERIFY_DEPTH 6
+
+/* the smallest depth and the number of moves searched before late moves are */
+/* reduced.                                                                  */
+#define REDUCTION_DEPTH 3
+#define REDUCTION_MOVE 3
+
+/* the order of moves, see `order_moves`. quiet moves are ordered by their   */
+/* continuation history, between the counter-move and losing captures.       */
+#define ORDER_ROOT_MOVE 1000000
+#define ORDER_CAPTURE 500000
+#define ORDER_PROMOTION 400000
+#define ORDER_COUNTER_MOVE 300000
+#define ORDER_LOSING_CAPTURE -100000
+
+/* the largest continuation history score, and the largest change to it      */
+/* after one cutoff.                                                         */
+#define HISTORY_MAX 16384
+#define HISTORY_BONUS 2048
+
+/* every this many points of continuation history change the reduction of    */
+/* a late move by one ply.                                                   */
+#define HISTORY_REDUCTION 8192
+
+/* the tunable parameters with their defaults and ranges.                    */
+#define OPTION(name, field, value, min, max) { name, offsetof(struct search_params, field), value, min, max }
+
+const struct search_option search_options[] = {
+	OPTION("FutilityMargin", futility_margin, 100, 0, 1000),
+	OPTION("FutilityDepth", futility_depth, 3, 0, MAX_DEPTH),
+	OPTION("ReverseFutilityMargin", reverse_futility_margin, 80, 0, 1000),
+	OPTION("ReverseFutilityDepth", reverse_futility_depth, 6, 0, MAX_DEPTH),
+	OPTION("RazorMargin", razor_margin, 250, 0, 2000),
+	OPTION("RazorDepth", razor_depth, 2, 0, MAX_DEPTH),
+	OPTION("ReductionBase", reduction_base, 75, 0, 500),
+	OPTION("ReductionDivisor", reduction_divisor, 225, 50, 1000),
+	OPTION("LateMoveCount", late_move_count, 3, 0, 256),
+	OPTION("LateMoveDepth", late_move_depth, 4, 0, MAX_DEPTH),
+	OPTION("SeeCaptureMargin", see_capture_margin, 100, 0, 1000),
+	OPTION("SeeQuietMargin", see_quiet_margin, 60, 0, 1000),
+	OPTION("SeeDepth", see_depth, 4, 0, MAX_DEPTH),
+	OPTION("AspirationWindow", aspiration_window, 30, 0, 1000),
+	OPTION("AspirationGrowth", aspiration_growth, 100, 10, 1000),
+	OPTION("AspirationDepth", aspiration_depth, 4, 1, MAX_DEPTH),
+	OPTION("QuiescenceChecks", quiescence_checks, 0, 0, 1),
+	{ NULL, 0, 0, 0, 0 }
+};
+
+/* the value of pieces for ordering captures, indexed by type.               */
+static const int order_value[6] = { 1, 3, 3, 5, 9, 10 };
+
+/* returns the time in seconds, from a clock that is not affected by changes */
+/* to the system time.                                                       */
+static double get_time(void) {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static long elapsed_time(const struct search_state *state) {
+	return (long)((get_time() - state->start_time) * 1000);
+}
+
+/* returns the time in milliseconds that counts towards the time limit.      */
+static long limit_time(const struct search_state *state) {
+	return (long)((get_time() - state->limit_start) * 1000);
+}
+
+/* pick up a request to stop, or the end of pondering, from the control.     */
+static void poll_control(struct search_state *state) {
+	struct search_control *control = state->info->control;
+
+	if (!control) {
+		return;
+	}
+
+	pthread_mutex_lock(&control->mutex);
+
+	if (control->stop) {
+		state->stopped = 1;
+	}
+
+	if (state->pondering && !control->ponder) {
+		state->pondering = 0;
+		state->limit_start = get_time();
+	}
+
+	pthread_mutex_unlock(&control->mutex);
+}
+
+/* returns true if the search has reached one of its limits. the clock and   */
+/* the control are only read once every 1024 nodes, because they are         */
+/* relatively slow.                                                          */
+static int should_stop(struct search_state *state) {
+	if (state->max_nodes && state->nodes >= state->max_nodes) {
+		state->stopped = 1;
+	} else if ((state->nodes & 1023) == 0) {
+		poll_control(state);
+
+		if (!state->pondering && state->max_time && limit_time(state) >= state->max_time) {
+			state->stopped = 1;
+		}
+	}
+
+	return state->stopped;
+}
+
+static void update_reductions(struct search_params *params) {
+	int depth;
+	int move;
+
+	for (depth = 0; depth <= MAX_DEPTH; depth++) {
+		for (move = 0; move < REDUCTION_MOVES; move++) {
+			double reduction = 0;
+
+			if (depth > 0 && move > 0) {
+				reduction = params->reduction_base / 100.0 + log(depth) * log(move) / (params->reduction_divisor / 100.0);
+			}
+
+			params->reductions[depth][move] = (unsigned char)(reduction < MAX_DEPTH ? reduction : MAX_DEPTH);
+		}
+	}
+}
+
+void search_params_init(struct search_params *params) {
+	const struct search_option *option;
+
+	for (option = search_options; option->name; option++) {
+		*(int *)((char *)params + option->offset) = option->default_value;
+	}
+
+	update_reductions(params);
+}
+
+int search_params_set(struct search_params *params, const char *name, int value) {
+	const struct search_option *option;
+
+	for (option = search_options; option->name; option++) {
+		if (!strcmp(option->name, name)) {
+			if (value < option->min) {
+				value = option->min;
+			} else if (value > option->max) {
+				value = option->max;
+			}
+
+			*(int *)((char *)params + option->offset) = value;
+			update_reductions(params);
+
+			return SUCCESS;
+		}
+	}
+
+	return FAILURE;
+}
+
+int search_context_init(struct search_context *context) {
+	int index;
+
+	for (index = 0; index < PIECE_SQUARES; index++) {
+		context->counter_moves[index] = make_move(NO_SQUARE, NO_SQUARE, NO_TYPE);
+	}
+
+	context->continuation = calloc(2, sizeof *context->continuation);
+	context->moves = malloc(ARENA_MOVES * sizeof *context->moves);
+	context->scores = malloc(ARENA_MOVES * sizeof *context->scores);
+	context->lines = malloc(MAX_MOVES * sizeof *context->lines);
+
+	if (!context->moves || !context->scores || !context->lines) {
+		search_context_free(context);
+
+		return FAILURE;
+	}
+
+	return SUCCESS;
+}
+
+void search_context_free(struct search_context *context) {
+	free(context->continuation);
+	free(context->moves);
+	free(context->scores);
+	free(context->lines);
+	context->moves = NULL;
+	context->scores = NULL;
+	context->lines = NULL;
+	context->continuation = NULL;
+}
+
+/* halve the continuation history, see `struct search_context`. this keeps   */
+/* the scores far from `HISTORY_MAX`, so new cutoffs still change them.      */
+static void age_history(struct search_context *context) {
+	int16_t *entry;
+	int16_t *end;
+
+	if (!context->continuation) {
+		return;
+	}
+
+	end = &context->continuation[0][0][0] + 2 * PIECE_SQUARES * PIECE_SQUARES;
+
+	for (entry = &context->continuation[0][0][0]; entry < end; entry++) {
+		*entry /= 2;
+	}
+}
+
+/* returns true if the side to move has pieces other than pawns and the      */
+/* king. without them, zugzwang is common.                                   */
+static int has_pieces(const struct position *pos) {
+	int color = pos->side_to_move;
+	int index;
+
+	for (index = 0; index < pos->piece_count[color]; index++) {
+		int type = TYPE(pos->board[pos->pieces[color][index]]);
+
+		if (type != PAWN && type != KING) {
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+/* search the position after a null move with a reduced depth and a null     */
+/* window around `beta`. returns true if the position fails high, in which   */
+/* case it does not need to be searched.                                     */
+static int null_move_cutoff(struct search_state *state, const struct position *pos, int depth, int ply, int beta) {
+	struct position copy = *pos;
+	int reduced = depth - 1 - (depth >= 6 ? 3 : 2);
+	int score;
+
+	if (reduced < 0) {
+		reduced = 0;
+	}
+
+	/* positions before the null move are not repetitions of those after it, */
+	/* so the scan for repetitions must stop at the null move.               */
+	do_null_move(&copy);
+	copy.halfmove_clock = 0;
+	state->nodes++;
+	state->stack[ply].null_move = 1;
+	state->stack[ply].played = -1;
+	history_push(state->history, pos);
+	score = -minimax(state, &copy, reduced, ply + 1, -beta, -beta + 1);
+	history_pop(state->history);
+	state->stack[ply].null_move = 0;
+
+	if (state->stopped || score < beta) {
+		return 0;
+	}
+
+	if (depth < NULL_MOVE_VERIFY_DEPTH) {
+		return 1;
+	}
+
+	/* the verification search overwrites the principal variation of this    */
+	/* ply, which the caller starts over.                                    */
+	state->verifying++;
+	score = minimax(state, pos, reduced, ply, beta - 1, beta);
+	state->verifying--;
+	state->stack[ply].pv_length = 0;
+
+	return !state->stopped && score >= beta;
+}
+
+/* returns true if the two moves are the same.                               */
+static int same_move(struct move a, struct move b) {
+	return a.from_square == b.from_square && a.to_square == b.to_square && a.promotion_type == b.promotion_type;
+}
+
+/* returns the piece and destination of the move, see `played` in            */
+/* `struct search_state`.                                                    */
+static int move_index(const struct position *pos, struct move move) {
+	return pos->board[move.from_square] * 64 + move.to_square;
+}
+
+/* returns the continuation history score of a quiet move with the given     */
+/* index at the ply.                                                         */
+static int history_score(const struct search_state *state, int ply, int index) {
+	int score = 0;
+	int offset;
+
+	for (offset = 0; offset < 2 && state->continuation && ply > offset; offset++) {
+		if (state->stack[ply - offset - 1].played >= 0) {
+			score += state->continuation[offset][state->stack[ply - offset - 1].played][index];
+		}
+	}
+
+	return score;
+}
+
+/* change the continuation history of a quiet move by `bonus`. the change is */
+/* smaller the closer the score already is to `HISTORY_MAX`, so that the     */
+/* scores stay in range and keep adapting, like gravity.                     */
+static void update_history(struct search_state *state, int ply, int index, int bonus) {
+	int offset;
+
+	for (offset = 0; offset < 2 && state->continuation && ply > offset; offset++) {
+		if (state->stack[ply - offset - 1].played >= 0) {
+			int16_t *entry = &state->continuation[offset][state->stack[ply - offset - 1].played][index];
+
+			*entry += bonus - *entry * abs(bonus) / HISTORY_MAX;
+		}
+	}
+}
+
+/* returns true if the move captures a piece, including en passant.          */
+static int is_capture(const struct position *pos, struct move move) {
+	return pos->board[move.to_square] != NO_PIECE || (TYPE(pos->board[move.from_square]) == PAWN && move.to_square == pos->en_passant_square);
+}
+
+/* reward the quiet move at `index` that caused a cutoff, and punish the     */
+/* quiet moves before it that did not.                                       */
+static void update_quiet_moves(struct search_state *state, const struct position *pos, const struct move *moves, size_t index, int ply, int depth) {
+	int bonus = depth * depth * 16 < HISTORY_BONUS ? depth * depth * 16 : HISTORY_BONUS;
+	size_t other;
+
+	for (other = 0; other < index; other++) {
+		if (!is_capture(pos, moves[other]) && moves[other].promotion_type == NO_TYPE) {
+			update_history(state, ply, move_index(pos, moves[other]), -bonus);
+		}
+	}
+
+	update_history(state, ply, move_index(pos, moves[index]), bonus);
+
+	if (ply > 0 && state->stack[ply - 1].played >= 0) {
+		state->counter_moves[state->stack[ply - 1].played] = moves[index];
+	}
+}
+
+/* sort the moves by how likely they are to cause a cutoff, see `minimax`,   */
+/* and store their ordering scores in `scores`. the scores of losing         */
+/* captures are below `ORDER_LOSING_CAPTURE` by the material they lose.      */
+static void order_moves(const struct search_state *state, const struct position *pos, struct move *moves, int *scores, size_t count, int ply) {
+	struct move counter_move = make_move(NO_SQUARE, NO_SQUARE, NO_TYPE);
+	size_t index;
+
+	if (ply > 0 && state->stack[ply - 1].played >= 0) {
+		counter_move = state->counter_moves[state->stack[ply - 1].played];
+	}
+
+	for (index = 0; index < count; index++) {
+		struct move move = moves[index];
+		int score = 0;
+
+		if (ply == 0 && same_move(move, state->root_move)) {
+			score = ORDER_ROOT_MOVE;
+		} else if (is_capture(pos, move)) {
+			int victim = pos->board[move.to_square] == NO_PIECE ? PAWN : TYPE(pos->board[move.to_square]);
+			int attacker = TYPE(pos->board[move.from_square]);
+
+			/* taking a piece that is worth at least as much never loses.    */
+			if (order_value[victim] < order_value[attacker] && (score = see(pos, move)) < 0) {
+				scores[index] = ORDER_LOSING_CAPTURE + score;
+
+				continue;
+			}
+
+			score = ORDER_CAPTURE + order_value[victim] * 16 - order_value[attacker];
+		} else if (move.promotion_type != NO_TYPE) {
+			score = ORDER_PROMOTION;
+		} else if (same_move(move, counter_move)) {
+			score = ORDER_COUNTER_MOVE;
+		} else {
+			score = history_score(state, ply, move_index(pos, move));
+		}
+
+		if (move.promotion_type != NO_TYPE) {
+			score += order_value[move.promotion_type];
+		}
+
+		scores[index] = score;
+	}
+
+	/* insertion sort, which keeps the order of moves with equal scores.     */
+	for (index = 1; index < count; index++) {
+		struct move move = moves[index];
+		int score = scores[index];
+		size_t other = index;
+
+		while (other > 0 && scores[other - 1] < score) {
+			moves[other] = moves[other - 1];
+			scores[other] = scores[other - 1];
+			other--;
+		}
+
+		moves[other] = move;
+		scores[other] = score;
+	}
+}
+
+/* let the next ply put its moves in the move arena after the first `count`  */
+/* moves of this ply.                                                        */
+static void reserve_moves(struct search_state *state, int ply, size_t count) {
+	state->stack[ply + 1].moves = state->stack[ply].moves + count;
+	state->stack[ply + 1].scores = state->stack[ply].scores + count;
+}
+
+static int quiescence(struct search_state *state, const struct position *pos, int ply, int alpha, int beta, int checks);
+
+/* search a move of the quiescence search, and update the best score, alpha, */
+/* and the principal variation of the ply. returns non-zero if the search    */
+/* has to stop here, because the move caused a cutoff or a limit was         */
+/* reached.                                                                  */
+static int quiescence_move(struct search_state *state, const struct position *pos, int ply, struct move move, int *alpha, int beta, int *best_score) {
+	struct search_ply *frame = &state->stack[ply];
+	struct position copy = *pos;
+	int score;
+
+	do_move(&copy, move);
+	state->nodes++;
+	frame->played = move_index(pos, move);
+	score = -quiescence(state, &copy, ply + 1, -beta, -*alpha, 0);
+
+	if (state->stopped) {
+		return 1;
+	}
+
+	if (score > *best_score) {
+		*best_score = score;
+	}
+
+	if (score > *alpha) {
+		*alpha = score;
+		frame->pv[0] = move;
+		memcpy(frame->pv + 1, state->stack[ply + 1].pv, state->stack[ply + 1].pv_length * sizeof *frame->pv);
+		frame->pv_length = state->stack[ply + 1].pv_length + 1;
+	}
+
+	return *alpha >= beta;
+}
+
+/* search captures until the position is quiet, see `minimax`. with          */
+/* `checks`, quiet moves that give check are searched too.                   */
+static int quiescence(struct search_state *state, const struct position *pos, int ply, int alpha, int beta, int checks) {
+	struct search_ply *frame = &state->stack[ply];
+	struct move *moves = frame->moves;
+	int *scores = frame->scores;
+	size_t count;
+	size_t index;
+	int check;
+	int best_score = -INFINITE_SCORE;
+
+	frame->pv_length = 0;
+
+	if (ply == MAX_DEPTH) {
+		return evaluate(pos);
+	}
+
+	if (should_stop(state)) {
+		return 0;
+	}
+
+	check = in_check(pos);
+
+	/* stand pat: the side to move does not have to capture anything.        */
+	if (!check) {
+		best_score = evaluate(pos);
+
+		if (best_score >= beta) {
+			return best_score;
+		}
+
+		if (best_score > alpha) {
+			alpha = best_score;
+		}
+	}
 
-	result.score = -1000000;
+	count = generate_legal_moves(pos, moves);
 
-	if (depth == 0) {
-		/* we have reached our search depth, so evaluate the position.       */
-		result.score = evaluate(pos);
+	if (count == 0 && check) {
+		return -MATE_SCORE + ply;
+	}
+
+	reserve_moves(state, ply, count);
+
+	order_moves(state, pos, moves, scores, count, ply);
+
+	/* captures that do not lose material and promotions come first, the     */
+	/* rest is only searched when in check.                                  */
+	for (index = 0; index < count && (check || scores[index] >= ORDER_PROMOTION); index++) {
+		if (quiescence_move(state, pos, ply, moves[index], &alpha, beta, &best_score)) {
+			return state->stopped ? 0 : best_score;
+		}
+	}
+
+	if (check || !checks) {
+		return best_score;
+	}
+
+	/* at the first ply, quiet moves that give check follow, see             */
+	/* `quiescence_checks`. they are generated in the place of the moves     */
+	/* searched above, and only the legal ones are searched.                 */
+	count = generate_quiet_checks(pos, moves);
+	reserve_moves(state, ply, count);
+	order_moves(state, pos, moves, scores, count, ply);
+
+	for (index = 0; index < count; index++) {
+		if (is_legal(pos, moves[index]) && quiescence_move(state, pos, ply, moves[index], &alpha, beta, &best_score)) {
+			return state->stopped ? 0 : best_score;
+		}
+	}
+
+	return best_score;
+}
+
+/* returns true if the move is searched at the root: it is one of the        */
+/* `searchmoves`, if there are any, and not excluded.                        */
+static int is_root_move(const struct search_state *state, struct move move) {
+	const struct search_info *info = state->info;
+	int index;
+
+	for (index = 0; index < state->excluded_count; index++) {
+		if (same_move(move, state->excluded[index])) {
+			return 0;
+		}
+	}
+
+	for (index = 0; index < info->searchmoves_count; index++) {
+		if (same_move(move, info->searchmoves[index])) {
+			return 1;
+		}
+	}
+
+	return info->searchmoves_count == 0;
+}
+
+/* keep only the moves that are searched at the root, see `is_root_move`.    */
+static size_t filter_root_moves(const struct search_state *state, struct move *moves, size_t count) {
+	size_t index;
+	size_t kept = 0;
+
+	for (index = 0; index < count; index++) {
+		if (is_root_move(state, moves[index])) {
+			moves[kept++] = moves[index];
+		}
+	}
+
+	return kept;
+}
+
+int minimax(struct search_state *state, const struct position *pos, int depth, int ply, int alpha, int beta) {
+	const struct search_params *params = state->info->params;
+	struct search_ply *frame = &state->stack[ply];
+	struct move *moves = frame->moves;
+	int *scores = frame->scores;
+	size_t count;
+	size_t index;
+	int best_score = -INFINITE_SCORE;
+	int pv_node = beta - alpha > 1;
+	int futile = 0;
+	int quiet_count = 0;
+	int check;
+
+	frame->pv_length = 0;
+
+	if (ply == MAX_DEPTH) {
+		return evaluate(pos);
+	}
+
+	if (depth <= 0) {
+		/* we have reached our search depth, so resolve the captures and     */
+		/* evaluate the position.                                            */
+		return quiescence(state, pos, ply, alpha, beta, params->quiescence_checks);
+	}
+
+	if (should_stop(state)) {
+		return 0;
+	}
+
+	/* until the moves are generated, the next ply can use the whole arena   */
+	/* after the moves of the previous ply, for the null move search.        */
+	reserve_moves(state, ply, 0);
+	check = in_check(pos);
+	frame->static_eval = check ? 0 : evaluate(pos);
+
+	/* reverse futility pruning, razoring, and futility pruning. the scores  */
+	/* of tablebase positions and mates are left alone.                      */
+	if (ply > 0 && !pv_node && !check && alpha > -TABLEBASE_SCORE && beta < TABLEBASE_SCORE) {
+		if (depth <= params->reverse_futility_depth && frame->static_eval - params->reverse_futility_margin * depth >= beta) {
+			return frame->static_eval;
+		}
+
+		if (depth <= params->razor_depth && frame->static_eval + params->razor_margin * depth <= alpha) {
+			int score = quiescence(state, pos, ply, alpha, alpha + 1, params->quiescence_checks);
+
+			if (state->stopped) {
+				return 0;
+			}
+
+			if (score <= alpha) {
+				return score;
+			}
+
+			frame->pv_length = 0;
+		}
+
+		futile = depth <= params->futility_depth && frame->static_eval + params->futility_margin * depth <= alpha;
+	}
+
+	/* null move pruning, never for mate scores since a pass can not prove   */
+	/* a mate.                                                               */
+	if (ply > 0 && depth >= NULL_MOVE_DEPTH && !state->stack[ply - 1].null_move && !state->verifying && beta < MATE_SCORE - MAX_DEPTH) {
+		if (!check && frame->static_eval >= beta && has_pieces(pos) && null_move_cutoff(state, pos, depth, ply, beta)) {
+			return beta;
+		}
+
+		if (state->stopped) {
+			return 0;
+		}
+	}
+
+	count = generate_legal_moves(pos, moves);
+
+	/* without legal moves, the game is over.                                */
+	if (count == 0) {
+		return check ? -MATE_SCORE + ply : 0;
+	}
+
+	if (ply == 0) {
+		count = filter_root_moves(state, moves, count);
+	}
+
+	reserve_moves(state, ply, count);
+
+	order_moves(state, pos, moves, scores, count, ply);
+
+	for (index = 0; index < count; index++) {
+		struct position copy = *pos;
+		int quiet = !is_capture(pos, moves[index]) && moves[index].promotion_type == NO_TYPE;
+		int reduction = 0;
+		int score;
+		int wdl;
+
+		/* do a move, the current player in `copy` is then the opponent, and */
+		/* so when we call minimax we get the score of the opponent.         */
+		do_move(&copy, moves[index]);
+
+		/* quiet moves and losing captures that do not give check are pruned */
+		/* or reduced, but only once a move has been searched, so that a     */
+		/* position is never mistaken for a mate.                            */
+		if ((quiet || scores[index] < ORDER_LOSING_CAPTURE) && !check && best_score > -MATE_SCORE + MAX_DEPTH && !in_check(&copy)) {
+			if (quiet && (futile || (!pv_node && depth <= params->late_move_depth && quiet_count >= params->late_move_count + depth * depth))) {
+				continue;
+			}
+
+			if (ply > 0 && !pv_node && depth <= params->see_depth && see(pos, moves[index]) < -(quiet ? params->see_quiet_margin : params->see_capture_margin) * depth) {
+				continue;
+			}
+
+			if (quiet && depth >= REDUCTION_DEPTH && index >= REDUCTION_MOVE) {
+				reduction = params->reductions[depth][index + 1 < REDUCTION_MOVES ? index + 1 : REDUCTION_MOVES - 1] - pv_node;
+				reduction -= history_score(state, ply, move_index(pos, moves[index])) / HISTORY_REDUCTION;
+
+				if (reduction > depth - 2) {
+					reduction = depth - 2;
+				}
+			}
+		}
+
+		quiet_count += quiet;
+		state->nodes++;
+		state->stack[ply + 1].pv_length = 0;
+		frame->played = move_index(pos, moves[index]);
+
+		/* minimax is called recursively. this call returns the score of the */
+		/* opponent, so we must negate it to get our score. the bounds are   */
+		/* negated and swapped for the same reason. when the position is a   */
+		/* draw, or the tablebases know the result, we do not need to search */
+		/* at all. a reduced move is searched with a null window first, and  */
+		/* again at the full depth if it raises alpha.                       */
+		history_push(state->history, pos);
+
+		if (is_draw(state->history, &copy)) {
+			score = 0;
+		} else if (tb_probe_wdl(&copy, &wdl) == SUCCESS) {
+			score = wdl == TB_WIN ? -TABLEBASE_SCORE : wdl == TB_LOSS ? TABLEBASE_SCORE : 0;
+		} else {
+			score = alpha + 1;
+
+			if (reduction > 0) {
+				score = -minimax(state, &copy, depth - 1 - reduction, ply + 1, -alpha - 1, -alpha);
+			}
+
+			if (score > alpha && !state->stopped) {
+				score = -minimax(state, &copy, depth - 1, ply + 1, -beta, -alpha);
+			}
+		}
+
+		history_pop(state->history);
+
+		if (state->stopped) {
+			return 0;
+		}
+
+		/* update the best line if we found a better move.                   */
+		if (score > best_score) {
+			best_score = score;
+		}
+
+		if (score > alpha) {
+			alpha = score;
+			frame->pv[0] = moves[index];
+			memcpy(frame->pv + 1, state->stack[ply + 1].pv, state->stack[ply + 1].pv_length * sizeof *frame->pv);
+			frame->pv_length = state->stack[ply + 1].pv_length + 1;
+
+			/* the opponent will avoid this position, no need to search the  */
+			/* other moves.                                                  */
+			if (alpha >= beta) {
+				if (quiet) {
+					update_quiet_moves(state, pos, moves, index, ply, depth);
+				}
+
+				break;
+			}
+		}
+	}
+
+	return best_score;
+}
+
+/* print a UCI info line with the principal variation at the root. `line`    */
+/* is the number of the line with `multipv`, starting at 1. `bound` is       */
+/* " lowerbound" or " upperbound" when the score is only a bound, and empty  */
+/* otherwise.                                                                */
+static void print_info(const struct search_state *state, int depth, int line, int score, const char *bound, const struct move *pv, int pv_length) {
+	long time = elapsed_time(state);
+	char buffer[128 + (MAX_DEPTH + 1) * 6];
+	char *end = buffer;
+	int index;
+
+	/* the line is written at once, see `uci_print`.                         */
+	end += sprintf(end, "info depth %d", depth);
+
+	if (state->info->multipv > 1) {
+		end += sprintf(end, " multipv %d", line);
+	}
+
+	if (score >= MATE_SCORE - MAX_DEPTH) {
+		end += sprintf(end, " score mate %d%s", (MATE_SCORE - score + 1) / 2, bound);
+	} else if (score <= -MATE_SCORE + MAX_DEPTH) {
+		end += sprintf(end, " score mate %d%s", -(MATE_SCORE + score) / 2, bound);
 	} else {
-		struct move moves[MAX_MOVES];
-		size_t count = generate_legal_moves(pos, moves);
-		size_t index;
+		end += sprintf(end, " score cp %d%s", score, bound);
+	}
+
+	end += sprintf(end, " nodes %lu time %ld nps %lu", state->nodes, time, (unsigned long)(state->nodes * 1000.0 / (time + 1)));
+
+	if (pv_length > 0) {
+		end += sprintf(end, " pv");
+	}
+
+	for (index = 0; index < pv_length; index++) {
+		*end++ = ' ';
+		format_move(end, pv[index]);
+		end += strlen(end);
+	}
+
+	uci_print("%s\n", buffer);
+}
+
+/* sort the lines and their first moves by score, best first. lines with     */
+/* the same score keep their order.                                          */
+static void sort_lines(struct search_line *lines, struct move *line_moves, int count) {
+	int index;
+
+	for (index = 1; index < count; index++) {
+		struct search_line line = lines[index];
+		struct move move = line_moves[index];
+		int target = index;
+
+		while (target > 0 && lines[target - 1].score < line.score) {
+			lines[target] = lines[target - 1];
+			line_moves[target] = line_moves[target - 1];
+			target--;
+		}
+
+		lines[target] = line;
+		line_moves[target] = move;
+	}
+}
+
+struct search_result search(const struct search_info *info) {
+	struct search_state state;
+	struct search_result result;
+	struct move moves[MAX_MOVES];
+	struct move line_moves[MAX_MOVES];
+	struct search_line *lines = info->context->lines;
+	int max_depth = info->depth ? info->depth : MAX_DEPTH;
+	int color = info->pos->side_to_move;
+	size_t count;
+	int line_count;
+	int completed;
+	int depth;
+	int line;
+	int index;
+	int wdl;
+
+	state.info = info;
+	state.history = info->history;
+	state.nodes = 0;
+	state.max_nodes = info->nodes;
+	state.start_time = get_time();
+	state.max_time = info->movetime;
+	state.stopped = 0;
+	state.pondering = 0;
+	state.limit_start = state.start_time;
+	state.root_move = make_move(NO_SQUARE, NO_SQUARE, NO_TYPE);
+	state.verifying = 0;
+
+	/* on a clock, spend a thirtieth of the remaining time and half the      */
+	/* increment, but never more than half the remaining time.               */
+	if (!state.max_time && info->time[color] > 0) {
+		state.max_time = info->time[color] / 30 + info->increment[color] / 2;
+
+		if (state.max_time > info->time[color] / 2) {
+			state.max_time = info->time[color] / 2 + 1;
+		}
+	}
+
+	if (!info->depth && !info->nodes && !state.max_time) {
+		max_depth = DEFAULT_DEPTH;
+	}
+
+	if (info->control) {
+		pthread_mutex_lock(&info->control->mutex);
+		state.pondering = info->control->ponder;
+		pthread_mutex_unlock(&info->control->mutex);
+	}
+
+	if (max_depth > MAX_DEPTH) {
+		max_depth = MAX_DEPTH;
+	}
+
+	result.move = make_move(NO_SQUARE, NO_SQUARE, NO_TYPE);
+	result.score = 0;
+	result.depth = 0;
+	result.nodes = 0;
+	result.pv_length = 0;
+
+	count = generate_legal_moves(info->pos, moves);
+
+	if (count == 0) {
+		result.score = in_check(info->pos) ? -MATE_SCORE : 0;
+
+		return result;
+	}
+
+	/* with `searchmoves` only those moves are searched, and there can not   */
+	/* be more lines than moves.                                             */
+	state.excluded = line_moves;
+	state.excluded_count = 0;
+	count = filter_root_moves(&state, moves, count);
+	line_count = info->multipv < (int)count ? info->multipv : (int)count;
+
+	if (line_count < 1) {
+		line_count = 1;
+	}
+
+	/* play any move in case the first depth does not complete.              */
+	result.move = moves[0];
+
+	/* in a won or lost tablebase position the tables pick a move that makes */
+	/* progress. in a drawn one any drawing move will do, but we let minimax */
+	/* pick one so we keep some chances if the opponent goes wrong.          */
+	if (info->searchmoves_count == 0 && line_count == 1 && tb_probe_root(info->pos, &result.move, &wdl) == SUCCESS && wdl != TB_DRAW) {
+		result.score = wdl == TB_WIN ? TABLEBASE_SCORE : -TABLEBASE_SCORE;
+		result.pv[0] = result.move;
+		result.pv_length = 1;
+
+		return result;
+	}
+
+	/* the recursion takes its moves and scores from the arena of the        */
+	/* context, so the stack frames stay small. without it we play the first */
+	/* move.                                                                 */
+	state.moves = info->context->moves;
+	state.scores = info->context->scores;
+
+	if (!state.moves || !state.scores || !lines) {
+		return result;
+	}
+
+	state.stack[0].moves = state.moves;
+	state.stack[0].scores = state.scores;
+
+	for (index = 0; index < MAX_DEPTH + 2; index++) {
+		state.stack[index].played = -1;
+		state.stack[index].null_move = 0;
+	}
+
+	for (line = 0; line < line_count; line++) {
+		line_moves[line] = make_move(NO_SQUARE, NO_SQUARE, NO_TYPE);
+		lines[line].score = 0;
+		lines[line].pv_length = 0;
+	}
 
-		for (index = 0; index < count; index++) {
-			struct position copy = *pos;
+	/* the search still works without continuation history, just slower.     */
+	age_history(info->context);
+	state.counter_moves = info->context->counter_moves;
+	state.continuation = info->context->continuation;
+	PROFILE_BEGIN(PROFILE_SEARCH);
+
+	for (depth = 1; depth <= max_depth && count > 0; depth++) {
+		/* every line is searched without the first moves of the lines       */
+		/* before it, which were already found at this depth.                */
+		for (completed = 0, line = 0; line < line_count; line++) {
+			int delta = info->params->aspiration_window;
+			int alpha = -INFINITE_SCORE;
+			int beta = INFINITE_SCORE;
 			int score;
 
-			/* do a move, the current player in `copy` is then the opponent, */
-			/* and so when we call minimax we get the score of the opponent. */
-			do_move(&copy, moves[index]);
+			state.excluded_count = line;
+			state.root_move = line_moves[line];
+
+			/* search a window around the score of the line at the previous  */
+			/* depth, and widen it on the side where the score falls outside */
+			/* of it.                                                        */
+			if (depth >= info->params->aspiration_depth && delta > 0 && abs(lines[line].score) < TABLEBASE_SCORE) {
+				alpha = lines[line].score - delta;
+				beta = lines[line].score + delta;
+			}
+
+			for (;;) {
+				score = minimax(&state, info->pos, depth, 0, alpha, beta);
+
+				if (state.stopped || (score > alpha && score < beta)) {
+					break;
+				}
 
-			/* minimax is called recursively. this call returns the score of */
-			/* the opponent, so we must negate it to get our score.          */
-			score = -minimax(&copy, depth - 1).score;
+				if (info->print_info) {
+					print_info(&state, depth, line + 1, score, score <= alpha ? " upperbound" : " lowerbound", state.stack[0].pv, state.stack[0].pv_length);
+				}
 
-			/* update the best move if we found a better one.                */
-			if (score > result.score) {
-				result.move = moves[index];
-				result.score = score;
+				if (score <= alpha) {
+					beta = (alpha + beta) / 2;
+					alpha = score - delta > -TABLEBASE_SCORE ? score - delta : -INFINITE_SCORE;
+				} else {
+					beta = score + delta < TABLEBASE_SCORE ? score + delta : INFINITE_SCORE;
+					state.root_move = state.stack[0].pv[0];
+				}
+
+				delta += delta * info->params->aspiration_growth / 100;
+			}
+
+			/* an unfinished depth is only better than nothing.              */
+			if (state.stopped && (depth > 1 || line > 0 || state.stack[0].pv_length == 0)) {
+				break;
 			}
+
+			line_moves[line] = state.stack[0].pv[0];
+			lines[line].score = score;
+			lines[line].pv_length = state.stack[0].pv_length;
+			memcpy(lines[line].pv, state.stack[0].pv, state.stack[0].pv_length * sizeof *lines[line].pv);
+			completed = line + 1;
+		}
+
+		/* a later line can score higher than an earlier one, since it is    */
+		/* searched with other bounds, so the lines are sorted by score      */
+		/* before they are printed. the best one is played, and searched     */
+		/* first at the next depth.                                          */
+		sort_lines(lines, line_moves, completed);
+
+		if (completed > 0) {
+			result.move = lines[0].pv[0];
+			result.score = lines[0].score;
+			result.depth = depth;
+			result.nodes = state.nodes;
+			result.pv_length = lines[0].pv_length;
+			memcpy(result.pv, lines[0].pv, lines[0].pv_length * sizeof *result.pv);
+		}
+
+		for (line = 0; line < completed && info->print_info; line++) {
+			print_info(&state, depth, line + 1, lines[line].score, "", lines[line].pv, lines[line].pv_length);
+		}
+
+		/* the next depth takes several times longer, so it would not finish */
+		/* in the time that is left.                                         */
+		poll_control(&state);
+
+		if (state.stopped || (!state.pondering && state.max_time && limit_time(&state) > state.max_time / 2)) {
+			break;
 		}
 	}
 
-	return result;
-}
+	PROFILE_END(PROFILE_SEARCH);
+	profile_flush(state.nodes);
+	result.nodes = state.nodes;
 
-struct move search(const struct search_info *info) {
-	return minimax(info->pos, 4).move;
+	return result;
 }
@@ -0,0 +1,78 @@
+#include "see.h"
+#include "generate.h"
+#include "types.h"
+
+/* the most captures in one exchange, one for every piece on the board.      */
+#define MAX_EXCHANGE 32
+
+static const int see_value[6] = { 100, 300, 300, 500, 900, 10000 };
+
+int see(const struct position *pos, struct move move) {
+	struct position copy = *pos;
+	int gain[MAX_EXCHANGE];
+	int square = move.to_square;
+	int piece = pos->board[move.from_square];
+	int color = pos->side_to_move;
+	int depth = 0;
+
+	gain[0] = 0;
+
+	if (pos->board[square] != NO_PIECE) {
+		gain[0] = see_value[TYPE(pos->board[square])];
+	} else if (TYPE(piece) == PAWN && square == pos->en_passant_square) {
+		gain[0] = see_value[PAWN];
+		copy.board[SQUARE(FILE(square), RANK(move.from_square))] = NO_PIECE;
+	}
+
+	if (move.promotion_type != NO_TYPE) {
+		piece = PIECE(color, move.promotion_type);
+		gain[0] += see_value[move.promotion_type] - see_value[PAWN];
+	}
+
+	/* only the board of the copy is kept up to date, which is all that      */
+	/* `least_valuable_attacker` looks at.                                   */
+	copy.board[square] = piece;
+	copy.board[move.from_square] = NO_PIECE;
+
+	/* every entry of `gain` is the material won by the side that captured   */
+	/* last, if the exchange stopped there.                                  */
+	while (depth + 1 < MAX_EXCHANGE) {
+		int from_square;
+
+		color = 1 - color;
+		from_square = least_valuable_attacker(&copy, square, color);
+
+		if (from_square == NO_SQUARE) {
+			break;
+		}
+
+		/* the king can only capture when nothing recaptures.                */
+		if (TYPE(copy.board[from_square]) == KING) {
+			int king = copy.board[from_square];
+
+			copy.board[from_square] = NO_PIECE;
+
+			if (least_valuable_attacker(&copy, square, 1 - color) != NO_SQUARE) {
+				break;
+			}
+
+			copy.board[from_square] = king;
+		}
+
+		depth++;
+		gain[depth] = see_value[TYPE(copy.board[square])] - gain[depth - 1];
+		copy.board[square] = copy.board[from_square];
+		copy.board[from_square] = NO_PIECE;
+	}
+
+	/* going back, every side picks the better of capturing and stopping.    */
+	while (depth > 0) {
+		if (-gain[depth] < gain[depth - 1]) {
+			gain[depth - 1] = -gain[depth];
+		}
+
+		depth--;
+	}
+
+	return gain[0];
+}
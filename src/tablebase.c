@@ -0,0 +1,682 @@
+#define _POSIX_C_SOURCE 200112L
+
+#include "tablebase.h"
+#include "generate.h"
+#include "types.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define MAGIC "CBTB"
+#define VERSION 1
+#define HEADER_SIZE 16
+
+/* room for every table up to five pieces.                                   */
+#define MAX_TABLES 512
+
+/* size of the hash table that maps material keys to tables, must be a power */
+/* of two larger than `MAX_TABLES`.                                          */
+#define MATERIAL_SLOTS 2048
+
+/* the order of the pieces in signatures.                                    */
+static const char piece_letters[] = "QRBNP";
+static const int piece_types[] = { QUEEN, ROOK, BISHOP, KNIGHT, PAWN };
+
+static struct tb_table tables[MAX_TABLES];
+static int table_count;
+static int largest;
+static int material_slots[MATERIAL_SLOTS];
+
+/* the index of the white king for pawnless tables, where it is restricted   */
+/* to the a1-d1-d4 triangle. other squares are -1.                           */
+static const int triangle[64] = {
+	 0,  1,  2,  3, -1, -1, -1, -1,
+	-1,  4,  5,  6, -1, -1, -1, -1,
+	-1, -1,  7,  8, -1, -1, -1, -1,
+	-1, -1, -1,  9, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1
+};
+
+static const int triangle_squares[10] = { 0, 1, 2, 3, 9, 10, 11, 18, 19, 27 };
+
+/* returns the position of a piece type in signatures, from 0 for queens to  */
+/* 4 for pawns.                                                              */
+static int letter_index(int type) {
+	return QUEEN - type;
+}
+
+static uint32_t material_key(int counts[2][5]) {
+	uint32_t key = 0;
+	int color;
+	int index;
+
+	for (color = WHITE; color <= BLACK; color++) {
+		for (index = 0; index < 5; index++) {
+			key |= (uint32_t)counts[color][index] << (3 * (5 * color + index));
+		}
+	}
+
+	return key;
+}
+
+/* returns the key with the colors swapped.                                  */
+static uint32_t flip_material(uint32_t key) {
+	return (key >> 15) | ((key & 0x7fff) << 15);
+}
+
+/* returns true if black is the stronger side, in which case the table is    */
+/* stored with the colors swapped.                                           */
+static int must_flip(int counts[2][5]) {
+	static const int values[5] = { 9, 5, 3, 3, 1 };
+	int sum[2] = { 0, 0 };
+	int color;
+	int index;
+
+	for (color = WHITE; color <= BLACK; color++) {
+		for (index = 0; index < 5; index++) {
+			sum[color] += values[index] * counts[color][index];
+		}
+	}
+
+	if (sum[WHITE] != sum[BLACK]) {
+		return sum[WHITE] < sum[BLACK];
+	}
+
+	for (index = 0; index < 5; index++) {
+		if (counts[WHITE][index] != counts[BLACK][index]) {
+			return counts[WHITE][index] < counts[BLACK][index];
+		}
+	}
+
+	return 0;
+}
+
+int tb_setup(struct tb_table *table, const char *name) {
+	int counts[2][5] = { { 0 } };
+	const char *c = name;
+	int color;
+	int index;
+
+	/* parse both sides, each starting with its king.                        */
+	for (color = WHITE; color <= BLACK; color++) {
+		if (*c++ != 'K') {
+			return FAILURE;
+		}
+
+		while (*c && strchr(piece_letters, *c)) {
+			counts[color][strchr(piece_letters, *c) - piece_letters]++;
+			c++;
+		}
+
+		if (color == WHITE && *c++ != 'v') {
+			return FAILURE;
+		}
+	}
+
+	if (*c || c - name >= (int)sizeof table->name) {
+		return FAILURE;
+	}
+
+	strcpy(table->name, name);
+	table->pieces[0] = PIECE(WHITE, KING);
+	table->pieces[1] = PIECE(BLACK, KING);
+	table->count = 2;
+	table->pawns = counts[WHITE][4] + counts[BLACK][4] > 0;
+	table->material = material_key(counts);
+	table->size = (table->pawns ? 32 : 10) * 64;
+	table->data = NULL;
+	table->data_size = 0;
+
+	for (color = WHITE; color <= BLACK; color++) {
+		for (index = 0; index < 5; index++) {
+			int n;
+
+			for (n = 0; n < counts[color][index]; n++) {
+				if (table->count == TB_MAX_PIECES) {
+					return FAILURE;
+				}
+
+				table->pieces[table->count++] = PIECE(color, piece_types[index]);
+				table->size *= piece_types[index] == PAWN ? 48 : 64;
+			}
+		}
+	}
+
+	return table->count > 2 ? SUCCESS : FAILURE;
+}
+
+void tb_signature(char *name, int counts[2][5]) {
+	int flip = must_flip(counts);
+	int color;
+	int index;
+
+	for (color = WHITE; color <= BLACK; color++) {
+		*name++ = 'K';
+
+		for (index = 0; index < 5; index++) {
+			int n;
+
+			for (n = 0; n < counts[color ^ flip][index]; n++) {
+				*name++ = piece_letters[index];
+			}
+		}
+
+		if (color == WHITE) {
+			*name++ = 'v';
+		}
+	}
+
+	*name = '\0';
+}
+
+/* add all signatures with `left` more pieces, choosing counts for the       */
+/* signature letters from `kind` on. kinds 0 to 4 are white, 5 to 9 black.   */
+static void add_names(char (*names)[16], int max_names, int *count, int counts[2][5], int kind, int left) {
+	if (kind == 10) {
+		if (left == 0 && !must_flip(counts) && *count < max_names) {
+			tb_signature(names[(*count)++], counts);
+		}
+
+		return;
+	}
+
+	for (counts[kind / 5][kind % 5] = left; counts[kind / 5][kind % 5] >= 0; counts[kind / 5][kind % 5]--) {
+		add_names(names, max_names, count, counts, kind + 1, left - counts[kind / 5][kind % 5]);
+	}
+
+	counts[kind / 5][kind % 5] = 0;
+}
+
+int tb_names(char (*names)[16], int max_names, int max_pieces) {
+	int counts[2][5] = { { 0 } };
+	int count = 0;
+	int pieces;
+
+	if (max_pieces > TB_MAX_PIECES) {
+		max_pieces = TB_MAX_PIECES;
+	}
+
+	for (pieces = 3; pieces <= max_pieces; pieces++) {
+		add_names(names, max_names, &count, counts, 0, pieces - 2);
+	}
+
+	return count;
+}
+
+uint32_t tb_material(const struct position *pos) {
+	int counts[2][5] = { { 0 } };
+	int color;
+	int index;
+
+	for (color = WHITE; color <= BLACK; color++) {
+		for (index = 0; index < pos->piece_count[color]; index++) {
+			int type = TYPE(pos->board[pos->pieces[color][index]]);
+
+			if (type != KING) {
+				counts[color][letter_index(type)]++;
+			}
+		}
+	}
+
+	return material_key(counts);
+}
+
+/* mirror the square in the a1-h8 diagonal.                                  */
+static int transpose(int square) {
+	return SQUARE(RANK(square), FILE(square));
+}
+
+/* returns the index of the pieces on the given squares, after sorting the   */
+/* squares of identical pieces so that their order does not matter.         */
+static uint64_t squares_index(const struct tb_table *table, int *squares) {
+	uint64_t index;
+	int slot;
+
+	for (slot = 3; slot < table->count; slot++) {
+		int other;
+
+		for (other = slot; other > 2 && table->pieces[other - 1] == table->pieces[other]; other--) {
+			if (squares[other - 1] > squares[other]) {
+				int square = squares[other];
+
+				squares[other] = squares[other - 1];
+				squares[other - 1] = square;
+			}
+		}
+	}
+
+	if (table->pawns) {
+		index = RANK(squares[0]) * 4 + FILE(squares[0]);
+	} else {
+		index = triangle[squares[0]];
+	}
+
+	for (slot = 1; slot < table->count; slot++) {
+		if (TYPE(table->pieces[slot]) == PAWN) {
+			index = index * 48 + squares[slot] - 8;
+		} else {
+			index = index * 64 + squares[slot];
+		}
+	}
+
+	return index;
+}
+
+/* returns the index of the pieces on the given squares, for the symmetry    */
+/* that moves the white king into its part of the board. when the white king */
+/* is on the diagonal of a pawnless table, both mirror images are valid, and */
+/* we use the smallest index.                                                */
+static uint64_t canonical_index(const struct tb_table *table, const int *squares) {
+	int transformed[TB_MAX_PIECES];
+	int mirror = 0;
+	int king;
+	int diagonal;
+	int slot;
+	uint64_t index;
+
+	if (FILE(squares[0]) > FILE_D) {
+		mirror ^= 7;
+	}
+
+	if (!table->pawns && RANK(squares[0]) > RANK_4) {
+		mirror ^= 56;
+	}
+
+	king = squares[0] ^ mirror;
+	diagonal = !table->pawns && RANK(king) > FILE(king);
+
+	for (slot = 0; slot < table->count; slot++) {
+		transformed[slot] = squares[slot] ^ mirror;
+
+		if (diagonal) {
+			transformed[slot] = transpose(transformed[slot]);
+		}
+	}
+
+	index = squares_index(table, transformed);
+
+	if (!table->pawns && RANK(king) == FILE(king)) {
+		uint64_t other;
+
+		for (slot = 0; slot < table->count; slot++) {
+			transformed[slot] = transpose(squares[slot] ^ mirror);
+		}
+
+		other = squares_index(table, transformed);
+
+		if (other < index) {
+			index = other;
+		}
+	}
+
+	return index;
+}
+
+uint64_t tb_index(const struct tb_table *table, const struct position *pos) {
+	int squares[TB_MAX_PIECES];
+	int flip = tb_material(pos) != table->material;
+	int side = flip ? 1 - pos->side_to_move : pos->side_to_move;
+	int square;
+
+	for (square = 0; square < TB_MAX_PIECES; square++) {
+		squares[square] = NO_SQUARE;
+	}
+
+	/* when black is the stronger side, swap the colors and mirror the board */
+	/* vertically to get a position with white as the stronger side.        */
+	for (square = 0; square < 64; square++) {
+		int piece = pos->board[square];
+		int slot;
+
+		if (piece == NO_PIECE) {
+			continue;
+		}
+
+		if (flip) {
+			piece ^= 1;
+		}
+
+		for (slot = 0; slot < table->count; slot++) {
+			if (table->pieces[slot] == piece && squares[slot] == NO_SQUARE) {
+				squares[slot] = flip ? square ^ 56 : square;
+
+				break;
+			}
+		}
+	}
+
+	return side * table->size + canonical_index(table, squares);
+}
+
+int tb_decode(const struct tb_table *table, uint64_t index, struct position *pos) {
+	int squares[TB_MAX_PIECES];
+	uint64_t rest = index % table->size;
+	int slot;
+
+	for (slot = table->count - 1; slot > 0; slot--) {
+		if (TYPE(table->pieces[slot]) == PAWN) {
+			squares[slot] = (int)(rest % 48) + 8;
+			rest /= 48;
+		} else {
+			squares[slot] = (int)(rest % 64);
+			rest /= 64;
+		}
+	}
+
+	if (table->pawns) {
+		squares[0] = SQUARE((int)rest % 4, (int)rest / 4);
+	} else {
+		squares[0] = triangle_squares[rest];
+	}
+
+	clear_board(pos);
+
+	for (slot = 0; slot < table->count; slot++) {
+		if (pos->board[squares[slot]] != NO_PIECE) {
+			return FAILURE;
+		}
+
+		put_piece(pos, squares[slot], table->pieces[slot]);
+	}
+
+	pos->side_to_move = index < table->size ? WHITE : BLACK;
+	pos->castling_rights[WHITE] = 0;
+	pos->castling_rights[BLACK] = 0;
+	pos->en_passant_square = NO_SQUARE;
+	pos->key = 0;
+	pos->halfmove_clock = 0;
+	update_attacks(pos);
+
+	return canonical_index(table, squares) == index % table->size ? SUCCESS : FAILURE;
+}
+
+/* returns the size of the file of a table.                                  */
+static size_t file_size(const struct tb_table *table) {
+	return HEADER_SIZE + (size_t)(table->size * 2 + 3) / 4 + (size_t)table->size * 2;
+}
+
+static void table_path(char *buffer, size_t size, const char *path, const char *name) {
+	buffer[0] = '\0';
+	strncat(buffer, path, size - 1);
+	strncat(buffer, "/", size - strlen(buffer) - 1);
+	strncat(buffer, name, size - strlen(buffer) - 1);
+	strncat(buffer, ".tb", size - strlen(buffer) - 1);
+}
+
+int tb_load(const char *path, const char *name) {
+	struct tb_table table;
+	struct stat st;
+	char buffer[4096];
+	void *data;
+	int fd;
+	int slot;
+
+	if (table_count == MAX_TABLES || tb_setup(&table, name) != SUCCESS) {
+		return FAILURE;
+	}
+
+	table_path(buffer, sizeof buffer, path, name);
+	fd = open(buffer, O_RDONLY);
+
+	if (fd < 0) {
+		return FAILURE;
+	}
+
+	if (fstat(fd, &st) != 0 || (size_t)st.st_size != file_size(&table)) {
+		close(fd);
+
+		return FAILURE;
+	}
+
+	data = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+
+	if (data == MAP_FAILED) {
+		return FAILURE;
+	}
+
+	if (memcmp(data, MAGIC, 4) != 0 || ((unsigned char *)data)[4] != VERSION || ((unsigned char *)data)[5] != table.count) {
+		munmap(data, st.st_size);
+
+		return FAILURE;
+	}
+
+	table.data = data;
+	table.data_size = st.st_size;
+
+	/* register the table under its material key.                            */
+	slot = table.material & (MATERIAL_SLOTS - 1);
+
+	while (material_slots[slot] != 0) {
+		if (tables[material_slots[slot] - 1].material == table.material) {
+			munmap(data, st.st_size);
+
+			return SUCCESS;
+		}
+
+		slot = (slot + 1) & (MATERIAL_SLOTS - 1);
+	}
+
+	tables[table_count++] = table;
+	material_slots[slot] = table_count;
+
+	if (table.count > largest) {
+		largest = table.count;
+	}
+
+	return SUCCESS;
+}
+
+int tb_write(const char *path, const struct tb_table *table, const unsigned char *wdl, const unsigned char *dtz) {
+	unsigned char header[HEADER_SIZE] = { 0 };
+	unsigned char packed = 0;
+	char buffer[4096];
+	uint64_t index;
+	FILE *stream;
+	int byte;
+
+	table_path(buffer, sizeof buffer, path, table->name);
+	stream = fopen(buffer, "wb");
+
+	if (!stream) {
+		return FAILURE;
+	}
+
+	memcpy(header, MAGIC, 4);
+	header[4] = VERSION;
+	header[5] = (unsigned char)table->count;
+
+	for (byte = 0; byte < 8; byte++) {
+		header[8 + byte] = (unsigned char)(table->size >> (56 - 8 * byte));
+	}
+
+	fwrite(header, sizeof header, 1, stream);
+
+	/* four WDL values per byte, the first one in the lowest bits.           */
+	for (index = 0; index < table->size * 2; index++) {
+		packed |= wdl[index] << (index % 4 * 2);
+
+		if (index % 4 == 3) {
+			fputc(packed, stream);
+			packed = 0;
+		}
+	}
+
+	if (index % 4 != 0) {
+		fputc(packed, stream);
+	}
+
+	fwrite(dtz, 1, table->size * 2, stream);
+
+	return fclose(stream) == 0 ? SUCCESS : FAILURE;
+}
+
+int tb_init(const char *path) {
+	static char names[MAX_TABLES][16];
+	int count = tb_names(names, MAX_TABLES, TB_MAX_PIECES);
+	int index;
+
+	tb_free();
+
+	for (index = 0; index < count; index++) {
+		tb_load(path, names[index]);
+	}
+
+	return table_count;
+}
+
+void tb_free(void) {
+	int index;
+
+	for (index = 0; index < table_count; index++) {
+		munmap((void *)tables[index].data, tables[index].data_size);
+	}
+
+	for (index = 0; index < MATERIAL_SLOTS; index++) {
+		material_slots[index] = 0;
+	}
+
+	table_count = 0;
+	largest = 0;
+}
+
+int tb_largest(void) {
+	return largest;
+}
+
+/* returns the table for the material key, or `NULL` if it is not loaded.    */
+static const struct tb_table *find_table(uint32_t material) {
+	int slot = material & (MATERIAL_SLOTS - 1);
+
+	while (material_slots[slot] != 0) {
+		if (tables[material_slots[slot] - 1].material == material) {
+			return &tables[material_slots[slot] - 1];
+		}
+
+		slot = (slot + 1) & (MATERIAL_SLOTS - 1);
+	}
+
+	return NULL;
+}
+
+int tb_lookup(const struct position *pos, int *wdl, int *dtz) {
+	uint32_t material = tb_material(pos);
+	const struct tb_table *table;
+	uint64_t index;
+	int value;
+
+	if (material == 0) {
+		*wdl = TB_DRAW;
+
+		if (dtz) {
+			*dtz = 0;
+		}
+
+		return SUCCESS;
+	}
+
+	table = find_table(material);
+
+	if (!table) {
+		table = find_table(flip_material(material));
+	}
+
+	if (!table) {
+		return FAILURE;
+	}
+
+	index = tb_index(table, pos);
+	value = table->data[HEADER_SIZE + index / 4] >> (index % 4 * 2) & 3;
+
+	if (value == TB_ILLEGAL) {
+		return FAILURE;
+	}
+
+	*wdl = value;
+
+	if (dtz) {
+		*dtz = table->data[HEADER_SIZE + (table->size * 2 + 3) / 4 + index];
+	}
+
+	return SUCCESS;
+}
+
+/* returns true if the position can be probed.                               */
+static int can_probe(const struct position *pos) {
+	if (largest == 0 || pos->castling_rights[WHITE] || pos->castling_rights[BLACK]) {
+		return 0;
+	}
+
+	if (pos->en_passant_square != NO_SQUARE) {
+		return 0;
+	}
+
+	return pos->piece_count[WHITE] + pos->piece_count[BLACK] <= largest;
+}
+
+int tb_probe_wdl(const struct position *pos, int *wdl) {
+	return can_probe(pos) ? tb_lookup(pos, wdl, NULL) : FAILURE;
+}
+
+int tb_probe_dtz(const struct position *pos, int *wdl, int *dtz) {
+	return can_probe(pos) ? tb_lookup(pos, wdl, dtz) : FAILURE;
+}
+
+int tb_probe_root(const struct position *pos, struct move *move, int *wdl) {
+	struct move moves[MAX_MOVES];
+	size_t count;
+	size_t index;
+	int best = -1;
+
+	if (tb_probe_wdl(pos, wdl) != SUCCESS) {
+		return FAILURE;
+	}
+
+	count = generate_legal_moves(pos, moves);
+
+	for (index = 0; index < count; index++) {
+		struct position copy = *pos;
+		int piece = pos->board[moves[index].from_square];
+		int zeroing = TYPE(piece) == PAWN || pos->board[moves[index].to_square] != NO_PIECE;
+		int child_wdl;
+		int child_dtz;
+		int rank;
+
+		do_move(&copy, moves[index]);
+
+		/* a double pawn push leaves an en passant square behind, which the  */
+		/* tables ignore.                                                    */
+		if (tb_lookup(&copy, &child_wdl, &child_dtz) != SUCCESS) {
+			return FAILURE;
+		}
+
+		/* the value of a move is the value of the position after it for the */
+		/* opponent, reversed.                                               */
+		if (TB_WIN - child_wdl != *wdl) {
+			continue;
+		}
+
+		/* when winning, mate first, then zeroing moves, then the moves that */
+		/* leave the opponent the shortest distance to zeroing. when losing, */
+		/* the other way around.                                             */
+		if (*wdl == TB_WIN) {
+			rank = 1000 - (child_dtz == 0 ? -1 : zeroing ? 0 : child_dtz);
+		} else {
+			rank = zeroing ? 1 : child_dtz + 1;
+		}
+
+		if (rank > best) {
+			*move = moves[index];
+			best = rank;
+		}
+	}
+
+	return best >= 0 ? SUCCESS : FAILURE;
+}
@@ -0,0 +1,728 @@
+#define _POSIX_C_SOURCE 200112L
+
+#include "tbgen.h"
+#include "generate.h"
+#include "tablebase.h"
+#include "types.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/* the number of positions handed to a thread at once. this is a multiple of */
+/* 64, so threads never share a word of a bitset.                            */
+#define CHUNK_SIZE 4096
+
+#define MAX_THREADS 256
+
+/* the state of a position during generation.                                */
+#define UNKNOWN 0
+#define ILLEGAL 1
+#define DRAW 2
+#define WIN 3
+#define LOSS 4
+
+/* the distance to zeroing of positions that are not decided yet. this is    */
+/* also what is stored for positions that take more than 254 plies.         */
+#define NO_DTZ 255
+
+struct tbgen {
+	const char *path;
+	int thread_count;
+
+	/* the table being generated, and its number of indices.                 */
+	struct tb_table table;
+	uint64_t total;
+
+	/* per index: the state, the number of moves that have not been shown   */
+	/* to lose yet, and the distance to zeroing.                             */
+	unsigned char *state;
+	unsigned char *counter;
+	unsigned char *dtz;
+
+	/* bitsets of the positions decided in the previous and current pass.    */
+	uint64_t *frontier;
+	uint64_t *next;
+
+	/* the distance to zeroing handled by the current pass.                  */
+	int distance;
+
+	/* everything below is shared between threads and protected by `mutex`. */
+	pthread_mutex_t mutex;
+	void (*work)(struct tbgen *gen, uint64_t begin, uint64_t end);
+	uint64_t next_chunk;
+	int changed;
+	int error;
+};
+
+static void *tbgen_worker(void *arg) {
+	struct tbgen *gen = arg;
+
+	for (;;) {
+		uint64_t begin;
+
+		pthread_mutex_lock(&gen->mutex);
+		begin = gen->next_chunk;
+		gen->next_chunk += CHUNK_SIZE;
+		pthread_mutex_unlock(&gen->mutex);
+
+		if (begin >= gen->total) {
+			break;
+		}
+
+		gen->work(gen, begin, begin + CHUNK_SIZE < gen->total ? begin + CHUNK_SIZE : gen->total);
+	}
+
+	return NULL;
+}
+
+/* run `work` on all indices, split in chunks over all threads.              */
+static void run_parallel(struct tbgen *gen, void (*work)(struct tbgen *gen, uint64_t begin, uint64_t end)) {
+	pthread_t threads[MAX_THREADS];
+	int index;
+
+	gen->work = work;
+	gen->next_chunk = 0;
+	gen->changed = 0;
+
+	for (index = 0; index < gen->thread_count; index++) {
+		pthread_create(&threads[index], NULL, tbgen_worker, gen);
+	}
+
+	for (index = 0; index < gen->thread_count; index++) {
+		pthread_join(threads[index], NULL);
+	}
+}
+
+static void set_changed(struct tbgen *gen) {
+	pthread_mutex_lock(&gen->mutex);
+	gen->changed = 1;
+	pthread_mutex_unlock(&gen->mutex);
+}
+
+static void set_error(struct tbgen *gen) {
+	pthread_mutex_lock(&gen->mutex);
+	gen->error = 1;
+	pthread_mutex_unlock(&gen->mutex);
+}
+
+static int test_bit(const uint64_t *bitset, uint64_t index) {
+	return (int)(bitset[index / 64] >> (index % 64) & 1);
+}
+
+/* set a bit that other threads may be setting at the same time.             */
+static void set_bit(uint64_t *bitset, uint64_t index) {
+	__sync_fetch_and_or(&bitset[index / 64], (uint64_t)1 << (index % 64));
+}
+
+/* add the offset to the square, returns `NO_SQUARE` if it is off the board. */
+static int offset_square(int square, int file_offset, int rank_offset) {
+	int file = FILE(square) + file_offset;
+	int rank = RANK(square) + rank_offset;
+
+	if (file >= 0 && file < 8 && rank >= 0 && rank < 8) {
+		return SQUARE(file, rank);
+	} else {
+		return NO_SQUARE;
+	}
+}
+
+static int king_square(const struct position *pos, int color) {
+	int index;
+
+	for (index = 0; index < pos->piece_count[color]; index++) {
+		if (pos->board[pos->pieces[color][index]] == PIECE(color, KING)) {
+			return pos->pieces[color][index];
+		}
+	}
+
+	return NO_SQUARE;
+}
+
+/* generate the legal moves, using `is_attacked` instead of `is_legal`. the  */
+/* positions in a table never have castling rights.                          */
+static size_t legal_moves(const struct position *pos, struct move *moves) {
+	size_t count = generate_pseudo_legal_moves(pos, moves);
+	size_t legal = 0;
+	size_t index;
+	int king = king_square(pos, pos->side_to_move);
+
+	for (index = 0; index < count; index++) {
+		struct position copy = *pos;
+		int square = moves[index].from_square == king ? moves[index].to_square : king;
+
+		do_move(&copy, moves[index]);
+
+		if (!is_attacked(&copy, square, copy.side_to_move)) {
+			moves[legal++] = moves[index];
+		}
+	}
+
+	return legal;
+}
+
+/* add an index to the list, unless it is already in it.                     */
+static void add_unique(uint64_t *indices, size_t *count, uint64_t index) {
+	size_t other;
+
+	for (other = 0; other < *count; other++) {
+		if (indices[other] == index) {
+			return;
+		}
+	}
+
+	indices[(*count)++] = index;
+}
+
+/* move the piece back from `from_square` to `to_square` and add the index   */
+/* of the resulting position.                                                */
+static void add_unmove(const struct tbgen *gen, struct position *pos, int from_square, int to_square, uint64_t *indices, size_t *count) {
+	move_piece(pos, from_square, to_square);
+	add_unique(indices, count, tb_index(&gen->table, pos));
+	move_piece(pos, to_square, from_square);
+}
+
+/* store the indices of all distinct positions from which the side that is   */
+/* not to move could have reached the position, without capturing or        */
+/* promoting. pawn moves are only taken back if `pawns` is true. some of the */
+/* positions may be illegal. returns the number of indices.                  */
+static size_t unmoves(const struct tbgen *gen, const struct position *pos, uint64_t *indices, int pawns) {
+	static const int knight[8][2] = { { -1, -2 }, { 1, -2 }, { -2, -1 }, { 2, -1 }, { -2, 1 }, { 2, 1 }, { -1, 2 }, { 1, 2 } };
+	static const int king[8][2] = { { -1, -1 }, { 0, -1 }, { 1, -1 }, { -1, 0 }, { 1, 0 }, { -1, 1 }, { 0, 1 }, { 1, 1 } };
+	struct position copy = *pos;
+	int color = 1 - pos->side_to_move;
+	size_t count = 0;
+	int square;
+
+	copy.side_to_move = color;
+
+	for (square = 0; square < 64; square++) {
+		int piece = pos->board[square];
+		int direction;
+
+		if (piece == NO_PIECE || COLOR(piece) != color) {
+			continue;
+		}
+
+		switch (TYPE(piece)) {
+			int backward;
+			int back;
+
+		case PAWN:
+			if (!pawns) {
+				break;
+			}
+
+			backward = color == WHITE ? -1 : 1;
+			back = offset_square(square, 0, backward);
+
+			if (RELATIVE(RANK(back), color) >= RANK_2 && copy.board[back] == NO_PIECE) {
+				add_unmove(gen, &copy, square, back, indices, &count);
+
+				/* double pawn pushes.                                       */
+				if (RELATIVE(RANK(square), color) == RANK_4) {
+					int back_back = offset_square(back, 0, backward);
+
+					if (copy.board[back_back] == NO_PIECE) {
+						add_unmove(gen, &copy, square, back_back, indices, &count);
+					}
+				}
+			}
+
+			break;
+
+		case KNIGHT:
+		case KING:
+			for (direction = 0; direction < 8; direction++) {
+				const int *offset = TYPE(piece) == KNIGHT ? knight[direction] : king[direction];
+				int to_square = offset_square(square, offset[0], offset[1]);
+
+				if (to_square != NO_SQUARE && copy.board[to_square] == NO_PIECE) {
+					add_unmove(gen, &copy, square, to_square, indices, &count);
+				}
+			}
+
+			break;
+
+		default:
+			for (direction = 0; direction < 8; direction++) {
+				int diagonal = king[direction][0] != 0 && king[direction][1] != 0;
+				int to_square;
+
+				if ((TYPE(piece) == BISHOP && !diagonal) || (TYPE(piece) == ROOK && diagonal)) {
+					continue;
+				}
+
+				to_square = offset_square(square, king[direction][0], king[direction][1]);
+
+				while (to_square != NO_SQUARE && copy.board[to_square] == NO_PIECE) {
+					add_unmove(gen, &copy, square, to_square, indices, &count);
+					to_square = offset_square(to_square, king[direction][0], king[direction][1]);
+				}
+			}
+
+			break;
+		}
+	}
+
+	return count;
+}
+
+/* examine every position once: find illegal positions, checkmates and      */
+/* stalemates, and positions decided by a capture or promotion. for the      */
+/* others, count the distinct positions reachable within the table.          */
+static void init_work(struct tbgen *gen, uint64_t begin, uint64_t end) {
+	uint64_t index;
+
+	for (index = begin; index < end; index++) {
+		struct position pos;
+		struct move moves[MAX_MOVES];
+		uint64_t children[MAX_MOVES];
+		size_t child_count = 0;
+		size_t count;
+		size_t move;
+		int side;
+		int win = 0;
+		int draw = 0;
+
+		if (tb_decode(&gen->table, index, &pos) != SUCCESS) {
+			gen->state[index] = ILLEGAL;
+
+			continue;
+		}
+
+		/* the side that is not to move can not be in check.                 */
+		side = pos.side_to_move;
+
+		if (is_attacked(&pos, king_square(&pos, 1 - side), side)) {
+			gen->state[index] = ILLEGAL;
+
+			continue;
+		}
+
+		count = legal_moves(&pos, moves);
+
+		for (move = 0; move < count; move++) {
+			struct position copy = pos;
+			int leaves = pos.board[moves[move].to_square] != NO_PIECE || moves[move].promotion_type != NO_TYPE;
+			int wdl;
+
+			do_move(&copy, moves[move]);
+
+			if (!leaves) {
+				add_unique(children, &child_count, tb_index(&gen->table, &copy));
+			} else if (tb_lookup(&copy, &wdl, NULL) != SUCCESS) {
+				set_error(gen);
+			} else if (wdl == TB_LOSS) {
+				win = 1;
+			} else if (wdl == TB_DRAW) {
+				draw = 1;
+			}
+		}
+
+		/* a move to a drawn position in another table can never be shown   */
+		/* to lose, so it counts as a move that keeps the position alive.   */
+		if (count == 0) {
+			int check = is_attacked(&pos, king_square(&pos, side), 1 - side);
+
+			gen->state[index] = check ? LOSS : DRAW;
+		} else if (win) {
+			gen->state[index] = WIN;
+		} else if (child_count + draw == 0) {
+			gen->state[index] = LOSS;
+		} else {
+			gen->state[index] = UNKNOWN;
+			gen->counter[index] = (unsigned char)(child_count + draw);
+		}
+
+		if (gen->state[index] == WIN || gen->state[index] == LOSS) {
+			gen->frontier[index / 64] |= (uint64_t)1 << (index % 64);
+		}
+	}
+}
+
+/* take back the moves to the positions decided in the previous pass.        */
+static void wdl_work(struct tbgen *gen, uint64_t begin, uint64_t end) {
+	uint64_t index;
+
+	for (index = begin; index < end; index++) {
+		struct position pos;
+		uint64_t parents[MAX_MOVES];
+		size_t count;
+		size_t parent;
+
+		if (!test_bit(gen->frontier, index)) {
+			continue;
+		}
+
+		tb_decode(&gen->table, index, &pos);
+		count = unmoves(gen, &pos, parents, 1);
+
+		for (parent = 0; parent < count; parent++) {
+			uint64_t other = parents[parent];
+
+			if (gen->state[index] == LOSS) {
+				/* a move to a lost position wins.                           */
+				if (__sync_bool_compare_and_swap(&gen->state[other], UNKNOWN, WIN)) {
+					set_bit(gen->next, other);
+				}
+			} else if (gen->state[other] == UNKNOWN) {
+				/* the position is lost once all its moves are shown to lead */
+				/* to won positions.                                         */
+				if (__sync_sub_and_fetch(&gen->counter[other], 1) == 0) {
+					if (__sync_bool_compare_and_swap(&gen->state[other], UNKNOWN, LOSS)) {
+						set_bit(gen->next, other);
+					}
+				}
+			}
+		}
+	}
+}
+
+/* find the positions that are won by zeroing into a lost position, and for  */
+/* lost positions count the distinct positions reachable without zeroing.    */
+static void dtz_init_work(struct tbgen *gen, uint64_t begin, uint64_t end) {
+	uint64_t index;
+
+	for (index = begin; index < end; index++) {
+		struct position pos;
+		struct move moves[MAX_MOVES];
+		uint64_t children[MAX_MOVES];
+		size_t child_count = 0;
+		size_t count;
+		size_t move;
+
+		if (gen->state[index] != WIN && gen->state[index] != LOSS) {
+			gen->dtz[index] = 0;
+
+			continue;
+		}
+
+		gen->dtz[index] = NO_DTZ;
+		tb_decode(&gen->table, index, &pos);
+		count = legal_moves(&pos, moves);
+
+		if (count == 0) {
+			gen->dtz[index] = 0;
+
+			continue;
+		}
+
+		for (move = 0; move < count; move++) {
+			struct position copy = pos;
+			int piece = pos.board[moves[move].from_square];
+			int capture = pos.board[moves[move].to_square] != NO_PIECE;
+			int leaves = capture || moves[move].promotion_type != NO_TYPE;
+			int zeroing = capture || TYPE(piece) == PAWN;
+			int wdl;
+
+			do_move(&copy, moves[move]);
+
+			if (gen->state[index] == LOSS) {
+				if (!zeroing) {
+					add_unique(children, &child_count, tb_index(&gen->table, &copy));
+				}
+			} else if (zeroing) {
+				if (leaves && tb_lookup(&copy, &wdl, NULL) == SUCCESS && wdl == TB_LOSS) {
+					gen->dtz[index] = 1;
+				} else if (!leaves && gen->state[tb_index(&gen->table, &copy)] == LOSS) {
+					gen->dtz[index] = 1;
+				}
+			}
+		}
+
+		if (gen->state[index] == LOSS) {
+			if (child_count == 0) {
+				gen->dtz[index] = 1;
+			} else {
+				gen->counter[index] = (unsigned char)child_count;
+			}
+		}
+	}
+}
+
+/* take back the non-zeroing moves to the positions at the current distance. */
+static void dtz_work(struct tbgen *gen, uint64_t begin, uint64_t end) {
+	unsigned char distance = (unsigned char)gen->distance;
+	unsigned char next = (unsigned char)(gen->distance + 1);
+	int changed = 0;
+	uint64_t index;
+
+	for (index = begin; index < end; index++) {
+		struct position pos;
+		uint64_t parents[MAX_MOVES];
+		size_t count;
+		size_t parent;
+
+		/* positions decided during this pass get `next`, which is never     */
+		/* equal to `distance`, so they are not picked up too early.         */
+		if (gen->dtz[index] != distance || (gen->state[index] != WIN && gen->state[index] != LOSS)) {
+			continue;
+		}
+
+		tb_decode(&gen->table, index, &pos);
+		count = unmoves(gen, &pos, parents, 0);
+
+		for (parent = 0; parent < count; parent++) {
+			uint64_t other = parents[parent];
+
+			if (gen->state[index] == LOSS && gen->state[other] == WIN) {
+				if (__sync_bool_compare_and_swap(&gen->dtz[other], NO_DTZ, next)) {
+					changed = 1;
+				}
+			} else if (gen->state[index] == WIN && gen->state[other] == LOSS && gen->dtz[other] == NO_DTZ) {
+				if (__sync_sub_and_fetch(&gen->counter[other], 1) == 0) {
+					if (__sync_bool_compare_and_swap(&gen->dtz[other], NO_DTZ, next)) {
+						changed = 1;
+					}
+				}
+			}
+		}
+	}
+
+	if (changed) {
+		set_changed(gen);
+	}
+}
+
+static int bitset_empty(const uint64_t *bitset, size_t words) {
+	size_t word;
+
+	for (word = 0; word < words; word++) {
+		if (bitset[word]) {
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+/* store the counts of the pieces of a table, as used in signatures.         */
+static void table_counts(const struct tb_table *table, int counts[2][5]) {
+	int slot;
+
+	memset(counts, 0, 2 * sizeof *counts);
+
+	for (slot = 2; slot < table->count; slot++) {
+		counts[COLOR(table->pieces[slot])][QUEEN - TYPE(table->pieces[slot])]++;
+	}
+}
+
+static int generate(struct tbgen *gen, const char *name);
+
+/* generate all tables reachable from the table with one capture or         */
+/* promotion.                                                                */
+static int generate_children(struct tbgen *gen, const struct tb_table *table) {
+	int counts[2][5];
+	int color;
+	int index;
+
+	table_counts(table, counts);
+
+	for (color = WHITE; color <= BLACK; color++) {
+		for (index = 0; index < 5; index++) {
+			char name[16];
+			int promotion;
+
+			if (counts[color][index] == 0) {
+				continue;
+			}
+
+			/* captures of this piece.                                       */
+			counts[color][index]--;
+			tb_signature(name, counts);
+
+			if (strcmp(name, "KvK") != 0 && generate(gen, name) != SUCCESS) {
+				return FAILURE;
+			}
+
+			/* promotions, if this piece is a pawn.                          */
+			for (promotion = 0; index == 4 && promotion < 4; promotion++) {
+				counts[color][promotion]++;
+				tb_signature(name, counts);
+				counts[color][promotion]--;
+
+				if (generate(gen, name) != SUCCESS) {
+					return FAILURE;
+				}
+			}
+
+			counts[color][index]++;
+		}
+	}
+
+	return SUCCESS;
+}
+
+static void print_summary(const struct tbgen *gen, double seconds) {
+	unsigned long values[2][5] = { { 0 } };
+	int longest = 0;
+	uint64_t index;
+
+	for (index = 0; index < gen->total; index++) {
+		values[index >= gen->table.size][gen->state[index]]++;
+
+		if ((gen->state[index] == WIN || gen->state[index] == LOSS) && gen->dtz[index] > longest) {
+			longest = gen->dtz[index];
+		}
+	}
+
+	printf("%s: %.1fs, longest dtz %d\n", gen->table.name, seconds, longest);
+	printf("  white to move: %lu wins, %lu draws, %lu losses\n", values[WHITE][WIN], values[WHITE][DRAW], values[WHITE][LOSS]);
+	printf("  black to move: %lu wins, %lu draws, %lu losses\n", values[BLACK][WIN], values[BLACK][DRAW], values[BLACK][LOSS]);
+	fflush(stdout);
+}
+
+static int build_table(struct tbgen *gen) {
+	size_t words = (size_t)(gen->total + 63) / 64;
+	time_t start = time(NULL);
+	uint64_t index;
+	int result = FAILURE;
+
+	gen->state = malloc(gen->total);
+	gen->counter = malloc(gen->total);
+	gen->dtz = malloc(gen->total);
+	gen->frontier = calloc(words, sizeof *gen->frontier);
+	gen->next = calloc(words, sizeof *gen->next);
+	gen->error = 0;
+
+	if (!gen->state || !gen->counter || !gen->dtz || !gen->frontier || !gen->next) {
+		fprintf(stderr, "tbgen: out of memory for %s\n", gen->table.name);
+	} else {
+		/* first round: win, draw, or loss.                                  */
+		run_parallel(gen, init_work);
+
+		while (!gen->error && !bitset_empty(gen->frontier, words)) {
+			uint64_t *frontier = gen->frontier;
+
+			run_parallel(gen, wdl_work);
+			memset(frontier, 0, words * sizeof *frontier);
+			gen->frontier = gen->next;
+			gen->next = frontier;
+		}
+
+		for (index = 0; index < gen->total; index++) {
+			if (gen->state[index] == UNKNOWN) {
+				gen->state[index] = DRAW;
+			}
+		}
+
+		/* second round: distance to zeroing. the first two distances come  */
+		/* from the initialization, so we keep going at least that far.      */
+		run_parallel(gen, dtz_init_work);
+
+		for (gen->distance = 0; !gen->error && gen->distance + 1 < NO_DTZ; gen->distance++) {
+			run_parallel(gen, dtz_work);
+
+			if (!gen->changed && gen->distance >= 1) {
+				break;
+			}
+		}
+
+		/* reuse the counters for the values we write to the file.           */
+		for (index = 0; index < gen->total; index++) {
+			static const unsigned char values[] = { TB_DRAW, TB_ILLEGAL, TB_DRAW, TB_WIN, TB_LOSS };
+
+			gen->counter[index] = values[gen->state[index]];
+		}
+
+		if (gen->error) {
+			fprintf(stderr, "tbgen: missing tables for %s\n", gen->table.name);
+		} else if (tb_write(gen->path, &gen->table, gen->counter, gen->dtz) != SUCCESS) {
+			fprintf(stderr, "tbgen: could not write %s\n", gen->table.name);
+		} else if (tb_load(gen->path, gen->table.name) != SUCCESS) {
+			fprintf(stderr, "tbgen: could not load %s\n", gen->table.name);
+		} else {
+			print_summary(gen, difftime(time(NULL), start));
+			result = SUCCESS;
+		}
+	}
+
+	free(gen->state);
+	free(gen->counter);
+	free(gen->dtz);
+	free(gen->frontier);
+	free(gen->next);
+
+	return result;
+}
+
+static int generate(struct tbgen *gen, const char *name) {
+	struct tb_table table;
+
+	if (tb_setup(&table, name) != SUCCESS) {
+		fprintf(stderr, "tbgen: invalid table %s\n", name);
+
+		return FAILURE;
+	}
+
+	/* tables that exist, either on disk or generated before, are loaded.    */
+	if (tb_load(gen->path, name) == SUCCESS) {
+		return SUCCESS;
+	}
+
+	if (generate_children(gen, &table) != SUCCESS) {
+		return FAILURE;
+	}
+
+	gen->table = table;
+	gen->total = table.size * 2;
+
+	return build_table(gen);
+}
+
+int tbgen_run(int argc, char **argv) {
+	struct tbgen gen;
+	int index;
+	int result = SUCCESS;
+
+	gen.path = ".";
+	gen.thread_count = (int)sysconf(_SC_NPROCESSORS_ONLN);
+
+	for (index = 0; index + 1 < argc && argv[index][0] == '-'; index += 2) {
+		if (!strcmp(argv[index], "-path")) {
+			gen.path = argv[index + 1];
+		} else if (!strcmp(argv[index], "-threads")) {
+			gen.thread_count = atoi(argv[index + 1]);
+		} else {
+			break;
+		}
+	}
+
+	if (index == argc || argv[index][0] == '-') {
+		fprintf(stderr, "usage: tbgen [-path dir] [-threads n] table ...\n");
+
+		return FAILURE;
+	}
+
+	if (gen.thread_count < 1) {
+		gen.thread_count = 1;
+	} else if (gen.thread_count > MAX_THREADS) {
+		gen.thread_count = MAX_THREADS;
+	}
+
+	pthread_mutex_init(&gen.mutex, NULL);
+	tb_free();
+
+	for (; index < argc && result == SUCCESS; index++) {
+		if (argv[index][0] >= '0' && argv[index][0] <= '9') {
+			static char names[512][16];
+			int count = tb_names(names, 512, atoi(argv[index]));
+			int name;
+
+			for (name = 0; name < count && result == SUCCESS; name++) {
+				result = generate(&gen, names[name]);
+			}
+		} else {
+			result = generate(&gen, argv[index]);
+		}
+	}
+
+	pthread_mutex_destroy(&gen.mutex);
+	tb_free();
+
+	return result;
+}
@@ -1,35 +1,101 @@
 
 #include "uci.h"
+#include "book.h"
+#include "cpu.h"
 #include "search.h"
+#include "tablebase.h"
+#include "generate.h"
 #include "move.h"
+#include "profile.h"
 #include "types.h"
 
+#include <stdarg.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <pthread.h>
 #include <stdbool.h>
 
-static int counter = 0;
+/* the longest line we accept. a `position` command takes 5 characters per   */
+/* move, so this is enough for games of several thousand moves.              */
+#define LINE_SIZE 65536
+
+/* the most moves of a game that are remembered for the next `position`.     */
+#define GAME_MOVES 8192
+
+#define STARTPOS "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1"
+
+/* lines are formatted into `output` and written with one call, both while   */
+/* holding `output_mutex`, see `uci_print`. the arguments never hold more    */
+/* than an input line.                                                       */
+static pthread_mutex_t output_mutex = PTHREAD_MUTEX_INITIALIZER;
+static char output[LINE_SIZE + 256];
+
+static struct book book;
+static struct history history;
+static struct search_params params;
+static int multipv = 1;
+
+/* the game set up by the last `position` command: the fen it started from,  */
+/* and the moves played since. a command that repeats them and adds a few    */
+/* more only has to play the new moves on the current position.              */
+static char game_fen[128];
+static struct move game_moves[GAME_MOVES];
+static int game_length;
+
+/* the search runs on its own thread, so we can still read `stop` and        */
+/* `ponderhit` while it runs. `control_changed` is signaled whenever the     */
+/* control changes, with its mutex held.                                     */
+static struct search_control control;
+static pthread_cond_t control_changed;
+static pthread_t search_thread;
+static int searching;
+
+/* what the search thread works on: a copy of the position, the search       */
+/* limits, the memory it searches with, kept for the whole session, and      */
+/* whether the search runs without limits until `stop`.                      */
+static struct position search_pos;
+static struct search_info search_info;
+static struct search_context search_context;
+static struct move search_moves[MAX_MOVES];
+static int infinite;
+
+void uci_print(const char *format, ...) {
+	va_list args;
+
+	pthread_mutex_lock(&output_mutex);
+	va_start(args, format);
+	vsprintf(output, format, args);
+	va_end(args);
+	fputs(output, stdout);
+	fflush(stdout);
+	pthread_mutex_unlock(&output_mutex);
+}
+
+/* read a line into the buffer, without the allocations. a line that does    */
+/* not fit is skipped, with an empty string in its place. returns `NULL` at  */
+/* the end of the stream.                                                    */
+static char *get_line(char *buffer, size_t size, FILE *stream) {
+	size_t length;
+
+	if (!fgets(buffer, size, stream)) {
+		return NULL;
+	}
 
-static char *get_line(FILE *stream) {
-	size_t capacity = 1024;
-	size_t size = 0;
-	char *string = malloc(capacity);
+	length = strlen(buffer);
 
-	while (fgets(string + size, capacity - size, stream)) {
-		size += strlen(string + size);
+	if (length + 1 == size && buffer[length - 1] != '\n') {
+		int c;
 
-		if (string[size - 1] == '\n') {
-			return string;
+		while ((c = getc(stream)) != EOF && c != '\n') {
 		}
 
-		capacity *= 2;
-		string = realloc(string, capacity);
+		uci_print("info string line too long, ignored\n");
+		buffer[0] = '\0';
 	}
 
-	free(string);
-
-	return NULL;
+	return buffer;
 }
 
 static char *get_token(char *string, char *store) {
@@ -56,71 +122,344 @@ static char *get_token(char *string, char *store) {
 	return NULL;
 }
 
+/* start the game over from the fen and play the first `length` moves of     */
+/* the last game again. those moves were checked when they were first        */
+/* played, so they are not checked again.                                    */
+static int replay_game(struct position *pos, int length) {
+	int index;
+
+	history.count = 0;
+
+	if (parse_position(pos, game_fen) != SUCCESS) {
+		return FAILURE;
+	}
+
+	for (index = 0; index < length; index++) {
+		history_push(&history, pos);
+		do_move(pos, game_moves[index]);
+
+		/* positions before a capture or pawn move can not repeat.           */
+		if (pos->halfmove_clock == 0) {
+			history.count = 0;
+		}
+	}
+
+	game_length = length;
+
+	return SUCCESS;
+}
+
+/* returns true if the move is one of the legal moves in the position.       */
+static int is_legal_move(const struct position *pos, struct move move) {
+	struct move moves[MAX_MOVES];
+	size_t count = generate_legal_moves(pos, moves);
+	size_t index;
+
+	for (index = 0; index < count; index++) {
+		if (moves[index].from_square == move.from_square && moves[index].to_square == move.to_square && moves[index].promotion_type == move.promotion_type) {
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+/* play the move if it is legal in the position, and add it to the game.     */
+static int play_move(struct position *pos, struct move move) {
+	if (!is_legal_move(pos, move)) {
+		return FAILURE;
+	}
+
+	history_push(&history, pos);
+	do_move(pos, move);
+
+	/* positions before a capture or pawn move can not repeat.               */
+	if (pos->halfmove_clock == 0) {
+		history.count = 0;
+	}
+
+	/* a game too long to remember is set up from scratch next time.         */
+	if (game_length < GAME_MOVES) {
+		game_moves[game_length++] = move;
+	} else {
+		game_fen[0] = '\0';
+	}
+
+	return SUCCESS;
+}
+
 static void uci_position(struct position *pos, char *token, char *store) {
+	char fen[sizeof game_fen] = "";
+	int length = 0;
+
 	token = get_token(token, store);
 
 	if (token && !strcmp(token, "startpos")) {
-		parse_position(pos, "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1");
+		strcpy(fen, STARTPOS);
 		token = get_token(token, store);
 	} else if (token && !strcmp(token, "fen")) {
-		char *fen = get_token(token, store);
+		char *start = get_token(token, store);
 		int index;
 
-		token = fen;
+		token = start;
 
 		for (index = 0; token && index < 5; index++) {
 			token = get_token(token, store);
 		}
 
-		if (token) {
-			parse_position(pos, fen);
+		/* the fen has to be copied before the next token is read.           */
+		if (token && strlen(start) < sizeof fen) {
+			strcpy(fen, start);
 			token = get_token(token, store);
 		}
 	}
 
+	if (!fen[0]) {
+		uci_print("info string invalid position\n");
+
+		return;
+	}
+
+	/* a different starting position is a new game.                          */
+	if (strcmp(fen, game_fen)) {
+		strcpy(game_fen, fen);
+
+		if (replay_game(pos, 0) != SUCCESS) {
+			uci_print("info string invalid fen %s\n", fen);
+			game_fen[0] = '\0';
+
+			return;
+		}
+	}
+
 	if (token && !strcmp(token, "moves")) {
 		while ((token = get_token(token, store))) {
 			struct move move;
 
-			if (parse_move(&move, token) == SUCCESS) {
-				do_move(pos, move);
+			if (parse_move(&move, token) != SUCCESS) {
+				uci_print("info string invalid move %s\n", token);
+
+				break;
 			}
+
+			/* skip the moves we already played, and go back to the point    */
+			/* where the game took a different turn.                         */
+			if (length < game_length) {
+				struct move played = game_moves[length];
+
+				if (played.from_square == move.from_square && played.to_square == move.to_square && played.promotion_type == move.promotion_type) {
+					length++;
+
+					continue;
+				}
+
+				replay_game(pos, length);
+			}
+
+			if (play_move(pos, move) != SUCCESS) {
+				uci_print("info string illegal move %s\n", token);
+
+				break;
+			}
+
+			length++;
+		}
+	}
+
+	/* the game was taken back to an earlier move.                           */
+	if (length < game_length) {
+		replay_game(pos, length);
+	}
+}
+
+/* append a token to a space separated string, silently truncating it when   */
+/* the buffer is full.                                                       */
+static void append_token(char *buffer, size_t size, const char *token) {
+	size_t length = strlen(buffer);
+
+	if (length > 0 && length + 1 < size) {
+		buffer[length++] = ' ';
+		buffer[length] = '\0';
+	}
+
+	strncat(buffer, token, size - length - 1);
+}
+
+static void uci_setoption(char *token, char *store) {
+	char name[256] = "";
+	char value[4096] = "";
+	char *target = NULL;
+
+	while ((token = get_token(token, store))) {
+		if (!strcmp(token, "name")) {
+			target = name;
+		} else if (!strcmp(token, "value")) {
+			target = value;
+		} else if (target == name) {
+			append_token(name, sizeof name, token);
+		} else if (target == value) {
+			append_token(value, sizeof value, token);
+		}
+	}
+
+	if (!strcmp(name, "BookFile")) {
+		if (!value[0] || !strcmp(value, "<empty>")) {
+			book_close(&book);
+		} else if (book_open(&book, value) != SUCCESS) {
+			uci_print("info string could not open book %s\n", value);
 		}
+	} else if (!strcmp(name, "TablebasePath")) {
+		if (!value[0] || !strcmp(value, "<empty>")) {
+			tb_free();
+		} else {
+			uci_print("info string loaded %d tablebases\n", tb_init(value));
+		}
+	} else if (!strcmp(name, "MultiPV")) {
+		multipv = atoi(value) < 1 ? 1 : atoi(value) > MAX_MOVES ? MAX_MOVES : atoi(value);
+	} else {
+		search_params_set(&params, name, atoi(value));
 	}
 }
 
-static void uci_go(const struct position *pos, char *token, char *store) {
-	struct search_info info;
+static void *search_worker(void *arg) {
 	struct move move;
-	char buffer[] = { '\0', '\0', '\0', '\0', '\0', '\0' };
-	char *str = NULL;
+	struct move ponder = make_move(NO_SQUARE, NO_SQUARE, NO_TYPE);
+	char buffer[8];
+	char line[32];
+
+	(void)arg;
+
+	/* book moves are played immediately, without searching.                 */
+	if (book_probe(&book, &search_pos, &move) != SUCCESS) {
+		struct search_result result = search(&search_info);
+
+		move = result.move;
+
+		/* the reply we expect is the move to ponder on.                     */
+		if (result.pv_length > 1) {
+			ponder = result.pv[1];
+		}
+	}
 
+	/* while pondering or searching without limits, the best move may only   */
+	/* be sent after `ponderhit` or `stop`, even if the search is done.      */
+	pthread_mutex_lock(&control.mutex);
+
+	while (!control.stop && (control.ponder || infinite)) {
+		pthread_cond_wait(&control_changed, &control.mutex);
+	}
 
-	info.pos = pos;
-	info.time[WHITE] = 0;
-	info.time[BLACK] = 0;
-	info.increment[WHITE] = 0;
-	info.increment[BLACK] = 0;
+	pthread_mutex_unlock(&control.mutex);
+
+	/* the whole line is written at once, see `uci_print`.                   */
+	format_move(buffer, move);
+	sprintf(line, "bestmove %s", buffer);
+
+	if (ponder.from_square != NO_SQUARE) {
+		format_move(buffer, ponder);
+		sprintf(line + strlen(line), " ponder %s", buffer);
+	}
+
+	uci_print("%s\n", line);
+
+	return NULL;
+}
+
+/* wait until the running search, if any, sent its move. with `stop` set,    */
+/* the search is told to stop first. searches that only end on `stop` or     */
+/* `ponderhit` are always stopped, or we would wait forever.                 */
+static void finish_search(int stop) {
+	if (!searching) {
+		return;
+	}
+
+	pthread_mutex_lock(&control.mutex);
+
+	if (stop || control.ponder || infinite) {
+		control.stop = 1;
+		pthread_cond_broadcast(&control_changed);
+	}
+
+	pthread_mutex_unlock(&control.mutex);
+
+	pthread_join(search_thread, NULL);
+	searching = 0;
+}
+
+/* switch a search on the opponent's time to a normal search, now that the   */
+/* opponent played the move we expected.                                     */
+static void ponder_hit(void) {
+	pthread_mutex_lock(&control.mutex);
+	control.ponder = 0;
+	pthread_cond_broadcast(&control_changed);
+	pthread_mutex_unlock(&control.mutex);
+}
+
+static void uci_go(const struct position *pos, char *token, char *store) {
+	struct search_info *info = &search_info;
+
+	search_pos = *pos;
+	info->pos = &search_pos;
+	info->history = &history;
+	info->time[WHITE] = 0;
+	info->time[BLACK] = 0;
+	info->increment[WHITE] = 0;
+	info->increment[BLACK] = 0;
+	info->depth = 0;
+	info->nodes = 0;
+	info->movetime = 0;
+	info->print_info = 1;
+	info->params = &params;
+	info->multipv = multipv;
+	info->searchmoves = search_moves;
+	info->searchmoves_count = 0;
+	info->control = &control;
+	info->context = &search_context;
+	control.stop = 0;
+	control.ponder = 0;
+	infinite = 0;
 
 	while ((token = get_token(token, store))) {
 		if (!strcmp(token, "searchmoves")) {
+			/* the moves take up the rest of the command.                    */
+			while ((token = get_token(token, store))) {
+				struct move move;
+
+				if (info->searchmoves_count < MAX_MOVES && parse_move(&move, token) == SUCCESS && is_legal_move(pos, move)) {
+					search_moves[info->searchmoves_count++] = move;
+				} else {
+					uci_print("info string illegal move %s\n", token);
+				}
+			}
+
 			break;
 		} else if (!strcmp(token, "ponder")) {
+			control.ponder = 1;
 			continue;
 		} else if (!strcmp(token, "infinite")) {
+			infinite = 1;
 			continue;
 		} else if (!strcmp(token, "wtime")) {
 			token = get_token(token, store);
-			info.time[WHITE] = token ? atoi(token) : 0;
+			info->time[WHITE] = token ? atoi(token) : 0;
 		} else if (!strcmp(token, "btime")) {
 			token = get_token(token, store);
-			info.time[BLACK] = token ? atoi(token) : 0;
+			info->time[BLACK] = token ? atoi(token) : 0;
 		} else if (!strcmp(token, "winc")) {
 			token = get_token(token, store);
-			info.increment[WHITE] = token ? atoi(token) : 0;
+			info->increment[WHITE] = token ? atoi(token) : 0;
 		} else if (!strcmp(token, "binc")) {
 			token = get_token(token, store);
-			info.increment[BLACK] = token ? atoi(token) : 0;
+			info->increment[BLACK] = token ? atoi(token) : 0;
+		} else if (!strcmp(token, "depth")) {
+			token = get_token(token, store);
+			info->depth = token ? atoi(token) : 0;
+		} else if (!strcmp(token, "nodes")) {
+			token = get_token(token, store);
+			info->nodes = token ? strtoul(token, NULL, 10) : 0;
+		} else if (!strcmp(token, "movetime")) {
+			token = get_token(token, store);
+			info->movetime = token ? atoi(token) : 0;
 		} else {
 			token = get_token(token, store);
 		}
@@ -129,38 +468,30 @@ static void uci_go(const struct position *pos, char *token, char *store) {
 		}
 	}
 
-	if (pos->side_to_move == 0 && counter < 3) {
-        str = opening_move_white(pos, counter);
-		counter++;
-    } else if (pos->side_to_move == 1 && counter < 4) {
-        str = opening_move_black(pos, &counter);
-    }
-	if (str)
-	{
-		strcpy(buffer, str);
+	/* without limits the search would stop at its default depth.            */
+	if (infinite && !info->depth) {
+		info->depth = MAX_DEPTH;
 	}
-	else
-	{
-		move = search(&info);
 
-		buffer[0] = "abcdefgh"[FILE(move.from_square)];
-		buffer[1] = '1' + RANK(move.from_square);
-		buffer[2] = "abcdefgh"[FILE(move.to_square)];
-		buffer[3] = '1' + RANK(move.to_square);
-
-		if (move.promotion_type != NO_TYPE) {
-			buffer[4] = "pnbrqk"[move.promotion_type];
-		}
+	if (pthread_create(&search_thread, NULL, search_worker, NULL) == 0) {
+		searching = 1;
+	} else {
+		uci_print("bestmove 0000\n");
 	}
-	printf("bestmove %s\n", buffer);
 }
 
-void uci_run() {
-	char *line;
+void uci_run(const char *name, const char *author) {
+	static char line[LINE_SIZE];
 	int quit = 0;
 	struct position pos;
+	const struct search_option *option;
+
+	search_params_init(&params);
+	search_context_init(&search_context);
+	pthread_mutex_init(&control.mutex, NULL);
+	pthread_cond_init(&control_changed, NULL);
 
-	while (!quit && (line = get_line(stdin))) {
+	while (!quit && get_line(line, sizeof line, stdin)) {
 		char *token = line;
 		char store = *token;
 
@@ -168,19 +499,48 @@ void uci_run() {
 
 		while ((token = get_token(token, &store))) {
 			if (!strcmp(token, "quit")) {
+				finish_search(1);
 				quit = 1;
+			} else if (!strcmp(token, "stop")) {
+				finish_search(1);
+			} else if (!strcmp(token, "ponderhit")) {
+				ponder_hit();
+			} else if (!strcmp(token, "profile")) {
+				token = get_token(token, &store);
+
+				if (token && !strcmp(token, "reset")) {
+					profile_reset();
+				} else {
+					pthread_mutex_lock(&output_mutex);
+					profile_report(stdout, "info string ");
+					fflush(stdout);
+					pthread_mutex_unlock(&output_mutex);
+				}
 			} else if (!strcmp(token, "uci")) {
-				printf("id name %s\n", "Team Alpaca");
-				printf("id author %s\n", "aalombro tcakir-y yulpark");
-				printf("uciok\n");
+				uci_print("id name %s\n", name);
+				uci_print("id author %s\n", author);
+				uci_print("info string cpu %s\n", cpu_description());
+				uci_print("option name BookFile type string default <empty>\n");
+				uci_print("option name TablebasePath type string default <empty>\n");
+				uci_print("option name Ponder type check default false\n");
+				uci_print("option name MultiPV type spin default 1 min 1 max %d\n", MAX_MOVES);
+
+				for (option = search_options; option->name; option++) {
+					uci_print("option name %s type spin default %d min %d max %d\n", option->name, option->default_value, option->min, option->max);
+				}
+
+				uci_print("uciok\n");
 			} else if (!strcmp(token, "isready")) {
-				printf("readyok\n");
+				uci_print("readyok\n");
 			} else if (!strcmp(token, "position")) {
+				finish_search(0);
 				uci_position(&pos, token, &store);
 			} else if (!strcmp(token, "go")) {
+				finish_search(0);
 				uci_go(&pos, token, &store);
 			} else if (!strcmp(token, "setoption")) {
-				break;
+				finish_search(0);
+				uci_setoption(token, &store);
 			} else if (!strcmp(token, "register")) {
 				break;
 			} else {
@@ -189,8 +549,8 @@ void uci_run() {
 
 			break;
 		}
-
-		free(line);
-		fflush(stdout);
 	}
+
+	finish_search(0);
+	search_context_free(&search_context);
 }
\ No newline at end of file
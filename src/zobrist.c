@@ -0,0 +1,334 @@
+#include "zobrist.h"
+#include "types.h"
+
+/* indices 0 to 767 are for pieces, 768 to 771 for castling rights, 772 to   */
+/* 779 for the en passant file, and 780 for the side to move.                */
+/*                                                                           */
+/* indices 556 to 767, for the queens and kings, are not the polyglot        */
+/* values, see `zobrist.h`.                                                  */
+const uint64_t zobrist_random[781] = {
+	UINT64_C(0x9D39247E33776D41), UINT64_C(0x2AF7398005AAA5C7), UINT64_C(0x44DB015024623547),
+	UINT64_C(0x9C15F73E62A76AE2), UINT64_C(0x75834465489C0C89), UINT64_C(0x3290AC3A203001BF),
+	UINT64_C(0x0FBBAD1F61042279), UINT64_C(0xE83A908FF2FB60CA), UINT64_C(0x0D7E765D58755C10),
+	UINT64_C(0x1A083822CEAFE02D), UINT64_C(0x9605D5F0E25EC3B0), UINT64_C(0xD021FF5CD13A2ED5),
+	UINT64_C(0x40BDF15D4A672E32), UINT64_C(0x011355146FD56395), UINT64_C(0x5DB4832046F3D9E5),
+	UINT64_C(0x239F8B2D7FF719CC), UINT64_C(0x05D1A1AE85B49AA1), UINT64_C(0x679F848F6E8FC971),
+	UINT64_C(0x7449BBFF801FED0B), UINT64_C(0x7D11CDB1C3B7ADF0), UINT64_C(0x82C7709E781EB7CC),
+	UINT64_C(0xF3218F1C9510786C), UINT64_C(0x331478F3AF51BBE6), UINT64_C(0x4BB38DE5E7219443),
+	UINT64_C(0xAA649C6EBCFD50FC), UINT64_C(0x8DBD98A352AFD40B), UINT64_C(0x87D2074B81D79217),
+	UINT64_C(0x19F3C751D3E92AE1), UINT64_C(0xB4AB30F062B19ABF), UINT64_C(0x7B0500AC42047AC4),
+	UINT64_C(0xC9452CA81A09D85D), UINT64_C(0x24AA6C514DA27500), UINT64_C(0x4C9F34427501B447),
+	UINT64_C(0x14A68FD73C910841), UINT64_C(0xA71B9B83461CBD93), UINT64_C(0x03488B95B0F1850F),
+	UINT64_C(0x637B2B34FF93C040), UINT64_C(0x09D1BC9A3DD90A94), UINT64_C(0x3575668334A1DD3B),
+	UINT64_C(0x735E2B97A4C45A23), UINT64_C(0x18727070F1BD400B), UINT64_C(0x1FCBACD259BF02E7),
+	UINT64_C(0xD310A7C2CE9B6555), UINT64_C(0xBF983FE0FE5D8244), UINT64_C(0x9F74D14F7454A824),
+	UINT64_C(0x51EBDC4AB9BA3035), UINT64_C(0x5C82C505DB9AB0FA), UINT64_C(0xFCF7FE8A3430B241),
+	UINT64_C(0x3253A729B9BA3DDE), UINT64_C(0x8C74C368081B3075), UINT64_C(0xB9BC6C87167C33E7),
+	UINT64_C(0x7EF48F2B83024E20), UINT64_C(0x11D505D4C351BD7F), UINT64_C(0x6568FCA92C76A243),
+	UINT64_C(0x4DE0B0F40F32A7B8), UINT64_C(0x96D693460CC37E5D), UINT64_C(0x42E240CB63689F2F),
+	UINT64_C(0x6D2BDCDAE2919661), UINT64_C(0x42880B0236E4D951), UINT64_C(0x5F0F4A5898171BB6),
+	UINT64_C(0x39F890F579F92F88), UINT64_C(0x93C5B5F47356388B), UINT64_C(0x63DC359D8D231B78),
+	UINT64_C(0xEC16CA8AEA98AD76), UINT64_C(0x5355F900C2A82DC7), UINT64_C(0x07FB9F855A997142),
+	UINT64_C(0x5093417AA8A7ED5E), UINT64_C(0x7BCBC38DA25A7F3C), UINT64_C(0x19FC8A768CF4B6D4),
+	UINT64_C(0x637A7780DECFC0D9), UINT64_C(0x8249A47AEE0E41F7), UINT64_C(0x79AD695501E7D1E8),
+	UINT64_C(0x14ACBAF4777D5776), UINT64_C(0xF145B6BECCDEA195), UINT64_C(0xDABF2AC8201752FC),
+	UINT64_C(0x24C3C94DF9C8D3F6), UINT64_C(0xBB6E2924F03912EA), UINT64_C(0x0CE26C0B95C980D9),
+	UINT64_C(0xA49CD132BFBF7CC4), UINT64_C(0xE99D662AF4243939), UINT64_C(0x27E6AD7891165C3F),
+	UINT64_C(0x8535F040B9744FF1), UINT64_C(0x54B3F4FA5F40D873), UINT64_C(0x72B12C32127FED2B),
+	UINT64_C(0xEE954D3C7B411F47), UINT64_C(0x9A85AC909A24EAA1), UINT64_C(0x70AC4CD9F04F21F5),
+	UINT64_C(0xF9B89D3E99A075C2), UINT64_C(0x87B3E2B2B5C907B1), UINT64_C(0xA366E5B8C54F48B8),
+	UINT64_C(0xAE4A9346CC3F7CF2), UINT64_C(0x1920C04D47267BBD), UINT64_C(0x87BF02C6B49E2AE9),
+	UINT64_C(0x092237AC237F3859), UINT64_C(0xFF07F64EF8ED14D0), UINT64_C(0x8DE8DCA9F03CC54E),
+	UINT64_C(0x9C1633264DB49C89), UINT64_C(0xB3F22C3D0B0B38ED), UINT64_C(0x390E5FB44D01144B),
+	UINT64_C(0x5BFEA5B4712768E9), UINT64_C(0x1E1032911FA78984), UINT64_C(0x9A74ACB964E78CB3),
+	UINT64_C(0x4F80F7A035DAFB04), UINT64_C(0x6304D09A0B3738C4), UINT64_C(0x2171E64683023A08),
+	UINT64_C(0x5B9B63EB9CEFF80C), UINT64_C(0x506AACF489889342), UINT64_C(0x1881AFC9A3A701D6),
+	UINT64_C(0x6503080440750644), UINT64_C(0xDFD395339CDBF4A7), UINT64_C(0xEF927DBCF00C20F2),
+	UINT64_C(0x7B32F7D1E03680EC), UINT64_C(0xB9FD7620E7316243), UINT64_C(0x05A7E8A57DB91B77),
+	UINT64_C(0xB5889C6E15630A75), UINT64_C(0x4A750A09CE9573F7), UINT64_C(0xCF464CEC899A2F8A),
+	UINT64_C(0xF538639CE705B824), UINT64_C(0x3C79A0FF5580EF7F), UINT64_C(0xEDE6C87F8477609D),
+	UINT64_C(0x799E81F05BC93F31), UINT64_C(0x86536B8CF3428A8C), UINT64_C(0x97D7374C60087B73),
+	UINT64_C(0xA246637CFF328532), UINT64_C(0x043FCAE60CC0EBA0), UINT64_C(0x920E449535DD359E),
+	UINT64_C(0x70EB093B15B290CC), UINT64_C(0x73A1921916591CBD), UINT64_C(0x56436C9FE1A1AA8D),
+	UINT64_C(0xEFAC4B70633B8F81), UINT64_C(0xBB215798D45DF7AF), UINT64_C(0x45F20042F24F1768),
+	UINT64_C(0x930F80F4E8EB7462), UINT64_C(0xFF6712FFCFD75EA1), UINT64_C(0xAE623FD67468AA70),
+	UINT64_C(0xDD2C5BC84BC8D8FC), UINT64_C(0x7EED120D54CF2DD9), UINT64_C(0x22FE545401165F1C),
+	UINT64_C(0xC91800E98FB99929), UINT64_C(0x808BD68E6AC10365), UINT64_C(0xDEC468145B7605F6),
+	UINT64_C(0x1BEDE3A3AEF53302), UINT64_C(0x43539603D6C55602), UINT64_C(0xAA969B5C691CCB7A),
+	UINT64_C(0xA87832D392EFEE56), UINT64_C(0x65942C7B3C7E11AE), UINT64_C(0xDED2D633CAD004F6),
+	UINT64_C(0x21F08570F420E565), UINT64_C(0xB415938D7DA94E3C), UINT64_C(0x91B859E59ECB6350),
+	UINT64_C(0x10CFF333E0ED804A), UINT64_C(0x28AED140BE0BB7DD), UINT64_C(0xC5CC1D89724FA456),
+	UINT64_C(0x5648F680F11A2741), UINT64_C(0x2D255069F0B7DAB3), UINT64_C(0x9BC5A38EF729ABD4),
+	UINT64_C(0xEF2F054308F6A2BC), UINT64_C(0xAF2042F5CC5C2858), UINT64_C(0x480412BAB7F5BE2A),
+	UINT64_C(0xAEF3AF4A563DFE43), UINT64_C(0x19AFE59AE451497F), UINT64_C(0x52593803DFF1E840),
+	UINT64_C(0xF4F076E65F2CE6F0), UINT64_C(0x11379625747D5AF3), UINT64_C(0xBCE5D2248682C115),
+	UINT64_C(0x9DA4243DE836994F), UINT64_C(0x066F70B33FE09017), UINT64_C(0x4DC4DE189B671A1C),
+	UINT64_C(0x51039AB7712457C3), UINT64_C(0xC07A3F80C31FB4B4), UINT64_C(0xB46EE9C5E64A6E7C),
+	UINT64_C(0xB3819A42ABE61C87), UINT64_C(0x21A007933A522A20), UINT64_C(0x2DF16F761598AA4F),
+	UINT64_C(0x763C4A1371B368FD), UINT64_C(0xF793C46702E086A0), UINT64_C(0xD7288E012AEB8D31),
+	UINT64_C(0xDE336A2A4BC1C44B), UINT64_C(0x0BF692B38D079F23), UINT64_C(0x2C604A7A177326B3),
+	UINT64_C(0x4850E73E03EB6064), UINT64_C(0xCFC447F1E53C8E1B), UINT64_C(0xB05CA3F564268D99),
+	UINT64_C(0x9AE182C8BC9474E8), UINT64_C(0xA4FC4BD4FC5558CA), UINT64_C(0xE755178D58FC4E76),
+	UINT64_C(0x69B97DB1A4C03DFE), UINT64_C(0xF9B5B7C4ACC67C96), UINT64_C(0xFC6A82D64B8655FB),
+	UINT64_C(0x9C684CB6C4D24417), UINT64_C(0x8EC97D2917456ED0), UINT64_C(0x6703DF9D2924E97E),
+	UINT64_C(0xC547F57E42A7444E), UINT64_C(0x78E37644E7CAD29E), UINT64_C(0xFE9A44E9362F05FA),
+	UINT64_C(0x08BD35CC38336615), UINT64_C(0x9315E5EB3A129ACE), UINT64_C(0x94061B871E04DF75),
+	UINT64_C(0xDF1D9F9D784BA010), UINT64_C(0x3BBA57B68871B59D), UINT64_C(0xD2B7ADEEDED1F73F),
+	UINT64_C(0xF7A255D83BC373F8), UINT64_C(0xD7F4F2448C0CEB81), UINT64_C(0xD95BE88CD210FFA7),
+	UINT64_C(0x336F52F8FF4728E7), UINT64_C(0xA74049DAC312AC71), UINT64_C(0xA2F61BB6E437FDB5),
+	UINT64_C(0x4F2A5CB07F6A35B3), UINT64_C(0x87D380BDA5BF7859), UINT64_C(0x16B9F7E06C453A21),
+	UINT64_C(0x7BA2484C8A0FD54E), UINT64_C(0xF3A678CAD9A2E38C), UINT64_C(0x39B0BF7DDE437BA2),
+	UINT64_C(0xFCAF55C1BF8A4424), UINT64_C(0x18FCF680573FA594), UINT64_C(0x4C0563B89F495AC3),
+	UINT64_C(0x40E087931A00930D), UINT64_C(0x8CFFA9412EB642C1), UINT64_C(0x68CA39053261169F),
+	UINT64_C(0x7A1EE967D27579E2), UINT64_C(0x9D1D60E5076F5B6F), UINT64_C(0x3810E399B6F65BA2),
+	UINT64_C(0x32095B6D4AB5F9B1), UINT64_C(0x35CAB62109DD038A), UINT64_C(0xA90B24499FCFAFB1),
+	UINT64_C(0x77A225A07CC2C6BD), UINT64_C(0x513E5E634C70E331), UINT64_C(0x4361C0CA3F692F12),
+	UINT64_C(0xD941ACA44B20A45B), UINT64_C(0x528F7C8602C5807B), UINT64_C(0x52AB92BEB9613989),
+	UINT64_C(0x9D1DFA2EFC557F73), UINT64_C(0x722FF175F572C348), UINT64_C(0x1D1260A51107FE97),
+	UINT64_C(0x7A249A57EC0C9BA2), UINT64_C(0x04208FE9E8F7F2D6), UINT64_C(0x5A110C6058B920A0),
+	UINT64_C(0x0CD9A497658A5698), UINT64_C(0x56FD23C8F9715A4C), UINT64_C(0x284C847B9D887AAE),
+	UINT64_C(0x04FEABFBBDB619CB), UINT64_C(0x742E1E651C60BA83), UINT64_C(0x9A9632E65904AD3C),
+	UINT64_C(0x881B82A13B51B9E2), UINT64_C(0x506E6744CD974924), UINT64_C(0xB0183DB56FFC6A79),
+	UINT64_C(0x0ED9B915C66ED37E), UINT64_C(0x5E11E86D5873D484), UINT64_C(0xF678647E3519AC6E),
+	UINT64_C(0x1B85D488D0F20CC5), UINT64_C(0xDAB9FE6525D89021), UINT64_C(0x0D151D86ADB73615),
+	UINT64_C(0xA865A54EDCC0F019), UINT64_C(0x93C42566AEF98FFB), UINT64_C(0x99E7AFEABE000731),
+	UINT64_C(0x48CBFF086DDF285A), UINT64_C(0x7F9B6AF1EBF78BAF), UINT64_C(0x58627E1A149BBA21),
+	UINT64_C(0x2CD16E2ABD791E33), UINT64_C(0xD363EFF5F0977996), UINT64_C(0x0CE2A38C344A6EED),
+	UINT64_C(0x1A804AADB9CFA741), UINT64_C(0x907F30421D78C5DE), UINT64_C(0x501F65EDB3034D07),
+	UINT64_C(0x37624AE5A48FA6E9), UINT64_C(0x957BAF61700CFF4E), UINT64_C(0x3A6C27934E31188A),
+	UINT64_C(0xD49503536ABCA345), UINT64_C(0x088E049589C432E0), UINT64_C(0xF943AEE7FEBF21B8),
+	UINT64_C(0x6C3B8E3E336139D3), UINT64_C(0x364F6FFA464EE52E), UINT64_C(0xD60F6DCEDC314222),
+	UINT64_C(0x56963B0DCA418FC0), UINT64_C(0x16F50EDF91E513AF), UINT64_C(0xEF1955914B609F93),
+	UINT64_C(0x565601C0364E3228), UINT64_C(0xECB53939887E8175), UINT64_C(0xBAC7A9A18531294B),
+	UINT64_C(0xB344C470397BBA52), UINT64_C(0x65D34954DAF3CEBD), UINT64_C(0xB4B81B3FA97511E2),
+	UINT64_C(0xB422061193D6F6A7), UINT64_C(0x071582401C38434D), UINT64_C(0x7A13F18BBEDC4FF5),
+	UINT64_C(0xBC4097B116C524D2), UINT64_C(0x59B97885E2F2EA28), UINT64_C(0x99170A5DC3115544),
+	UINT64_C(0x6F423357E7C6A9F9), UINT64_C(0x325928EE6E6F8794), UINT64_C(0xD0E4366228B03343),
+	UINT64_C(0x565C31F7DE89EA27), UINT64_C(0x30F5611484119414), UINT64_C(0xD873DB391292ED4F),
+	UINT64_C(0x7BD94E1D8E17DEBC), UINT64_C(0xC7D9F16864A76E94), UINT64_C(0x947AE053EE56E63C),
+	UINT64_C(0xC8C93882F9475F5F), UINT64_C(0x3A9BF55BA91F81CA), UINT64_C(0xD9A11FBB3D9808E4),
+	UINT64_C(0x0FD22063EDC29FCA), UINT64_C(0xB3F256D8ACA0B0B9), UINT64_C(0xB03031A8B4516E84),
+	UINT64_C(0x35DD37D5871448AF), UINT64_C(0xE9F6082B05542E4E), UINT64_C(0xEBFAFA33D7254B59),
+	UINT64_C(0x9255ABB50D532280), UINT64_C(0xB9AB4CE57F2D34F3), UINT64_C(0x693501D628297551),
+	UINT64_C(0xC62C58F97DD949BF), UINT64_C(0xCD454F8F19C5126A), UINT64_C(0xBBE83F4ECC2BDECB),
+	UINT64_C(0xDC842B7E2819E230), UINT64_C(0xBA89142E007503B8), UINT64_C(0xA3BC941D0A5061CB),
+	UINT64_C(0xE9F6760E32CD8021), UINT64_C(0x09C7E552BC76492F), UINT64_C(0x852F54934DA55CC9),
+	UINT64_C(0x8107FCCF064FCF56), UINT64_C(0x098954D51FFF6580), UINT64_C(0x23B70EDB1955C4BF),
+	UINT64_C(0xC330DE426430F69D), UINT64_C(0x4715ED43E8A45C0A), UINT64_C(0xA8D7E4DAB780A08D),
+	UINT64_C(0x0572B974F03CE0BB), UINT64_C(0xB57D2E985E1419C7), UINT64_C(0xE8D9ECBE2CF3D73F),
+	UINT64_C(0x2FE4B17170E59750), UINT64_C(0x11317BA87905E790), UINT64_C(0x7FBF21EC8A1F45EC),
+	UINT64_C(0x1725CABFCB045B00), UINT64_C(0x964E915CD5E2B207), UINT64_C(0x3E2B8BCBF016D66D),
+	UINT64_C(0xBE7444E39328A0AC), UINT64_C(0xF85B2B4FBCDE44B7), UINT64_C(0x49353FEA39BA63B1),
+	UINT64_C(0x1DD01AAFCD53486A), UINT64_C(0x1FCA8A92FD719F85), UINT64_C(0xFC7C95D827357AFA),
+	UINT64_C(0x18A6A990C8B35EBD), UINT64_C(0xCCCB7005C6B9C28D), UINT64_C(0x3BDBB92C43B17F26),
+	UINT64_C(0xAA70B5B4F89695A2), UINT64_C(0xE94C39A54A98307F), UINT64_C(0xB7A0B174CFF6F36E),
+	UINT64_C(0xD4DBA84729AF48AD), UINT64_C(0x2E18BC1AD9704A68), UINT64_C(0x2DE0966DAF2F8B1C),
+	UINT64_C(0xB9C11D5B1E43A07E), UINT64_C(0x64972D68DEE33360), UINT64_C(0x94628D38D0C20584),
+	UINT64_C(0xDBC0D2B6AB90A559), UINT64_C(0xD2733C4335C6A72F), UINT64_C(0x7E75D99D94A70F4D),
+	UINT64_C(0x6CED1983376FA72B), UINT64_C(0x97FCAACBF030BC24), UINT64_C(0x7B77497B32503B12),
+	UINT64_C(0x8547EDDFB81CCB94), UINT64_C(0x79999CDFF70902CB), UINT64_C(0xCFFE1939438E9B24),
+	UINT64_C(0x829626E3892D95D7), UINT64_C(0x92FAE24291F2B3F1), UINT64_C(0x63E22C147B9C3403),
+	UINT64_C(0xC678B6D860284A1C), UINT64_C(0x5873888850659AE7), UINT64_C(0x0981DCD296A8736D),
+	UINT64_C(0x9F65789A6509A440), UINT64_C(0x9FF38FED72E9052F), UINT64_C(0xE479EE5B9930578C),
+	UINT64_C(0xE7F28ECD2D49EECD), UINT64_C(0x56C074A581EA17FE), UINT64_C(0x5544F7D774B14AEF),
+	UINT64_C(0x7B3F0195FC6F290F), UINT64_C(0x12153635B2C0CF57), UINT64_C(0x7F5126DBBA5E0CA7),
+	UINT64_C(0x7A76956C3EAFB413), UINT64_C(0x3D5774A11D31AB39), UINT64_C(0x8A1B083821F40CB4),
+	UINT64_C(0x7B4A38E32537DF62), UINT64_C(0x950113646D1D6E03), UINT64_C(0x4DA8979A0041E8A9),
+	UINT64_C(0x3BC36E078F7515D7), UINT64_C(0x5D0A12F27AD310D1), UINT64_C(0x7F9D1A2E1EBE1327),
+	UINT64_C(0xDA3A361B1C5157B1), UINT64_C(0xDCDD7D20903D0C25), UINT64_C(0x36833336D068F707),
+	UINT64_C(0xCE68341F79893389), UINT64_C(0xAB9090168DD05F34), UINT64_C(0x43954B3252DC25E5),
+	UINT64_C(0xB438C2B67F98E5E9), UINT64_C(0x10DCD78E3851A492), UINT64_C(0xDBC27AB5447822BF),
+	UINT64_C(0x9B3CDB65F82CA382), UINT64_C(0xB67B7896167B4C84), UINT64_C(0xBFCED1B0048EAC50),
+	UINT64_C(0xA9119B60369FFEBD), UINT64_C(0x1FFF7AC80904BF45), UINT64_C(0xAC12FB171817EEE7),
+	UINT64_C(0xAF08DA9177DDA93D), UINT64_C(0x1B0CAB936E65C744), UINT64_C(0xB559EB1D04E5E932),
+	UINT64_C(0xC37B45B3F8D6F2BA), UINT64_C(0xC3A9DC228CAAC9E9), UINT64_C(0xF3B8B6675A6507FF),
+	UINT64_C(0x9FC477DE4ED681DA), UINT64_C(0x67378D8ECCEF96CB), UINT64_C(0x6DD856D94D259236),
+	UINT64_C(0xA319CE15B0B4DB31), UINT64_C(0x073973751F12DD5E), UINT64_C(0x8A8E849EB32781A5),
+	UINT64_C(0xE1925C71285279F5), UINT64_C(0x74C04BF1790C0EFE), UINT64_C(0x4DDA48153C94938A),
+	UINT64_C(0x9D266D6A1CC0542C), UINT64_C(0x7440FB816508C4FE), UINT64_C(0x13328503DF48229F),
+	UINT64_C(0xD6BF7BAEE43CAC40), UINT64_C(0x4838D65F6EF6748F), UINT64_C(0x1E152328F3318DEA),
+	UINT64_C(0x8F8419A348F296BF), UINT64_C(0x72C8834A5957B511), UINT64_C(0xD7A023A73260B45C),
+	UINT64_C(0x94EBC8ABCFB56DAE), UINT64_C(0x9FC10D0F989993E0), UINT64_C(0xDE68A2355B93CAE6),
+	UINT64_C(0xA44CFE79AE538BBE), UINT64_C(0x9D1D84FCCE371425), UINT64_C(0x51D2B1AB2DDFB636),
+	UINT64_C(0x2FD7E4B9E72CD38C), UINT64_C(0x65CA5B96B7552210), UINT64_C(0xDD69A0D8AB3B546D),
+	UINT64_C(0x604D51B25FBF70E2), UINT64_C(0x73AA8A564FB7AC9E), UINT64_C(0x1A8C1E992B941148),
+	UINT64_C(0xAAC40A2703D9BEA0), UINT64_C(0x764DBEAE7FA4F3A6), UINT64_C(0x1E99B96E70A9BE8B),
+	UINT64_C(0x2C5E9DEB57EF4743), UINT64_C(0x3A938FEE32D29981), UINT64_C(0x26E6DB8FFDF5ADFE),
+	UINT64_C(0x469356C504EC9F9D), UINT64_C(0xC8763C5B08D1908C), UINT64_C(0x3F6C6AF859D80055),
+	UINT64_C(0x7F7CC39420A3A545), UINT64_C(0x9BFB227EBDF4C5CE), UINT64_C(0x89039D79D6FC5C5C),
+	UINT64_C(0x8FE88B57305E2AB6), UINT64_C(0xA09E8C8C35AB96DE), UINT64_C(0xFA7E393983325753),
+	UINT64_C(0xD6B6D0ECC617C699), UINT64_C(0xDFEA21EA9E7557E3), UINT64_C(0xB67C1FA481680AF8),
+	UINT64_C(0xCA1E3785A9E724E5), UINT64_C(0x1CFC8BED0D681639), UINT64_C(0xD18D8549D140CAEA),
+	UINT64_C(0x4ED0FE7E9DC91335), UINT64_C(0xE4DBF0634473F5D2), UINT64_C(0x1761F93A44D5AEFE),
+	UINT64_C(0x53898E4C3910DA55), UINT64_C(0x734DE8181F6EC39A), UINT64_C(0x2680B122BAA28D97),
+	UINT64_C(0x298AF231C85BAFAB), UINT64_C(0x7983EED3740847D5), UINT64_C(0x66C1A2A1A60CD889),
+	UINT64_C(0x9E17E49642A3E4C1), UINT64_C(0xEDB454E7BADC0805), UINT64_C(0x50B704CAB602C329),
+	UINT64_C(0x4CC317FB9CDDD023), UINT64_C(0x66B4835D9EAFEA22), UINT64_C(0x219B97E26FFC81BD),
+	UINT64_C(0x261E4E4C0A333A9D), UINT64_C(0x1FE2CCA76517DB90), UINT64_C(0xD7504DFA8816EDBB),
+	UINT64_C(0xB9571FA04DC089C8), UINT64_C(0x1DDC0325259B27DE), UINT64_C(0xCF3F4688801EB9AA),
+	UINT64_C(0xF4F5D05C10CAB243), UINT64_C(0x38B6525C21A42B0E), UINT64_C(0x36F60E2BA4FA6800),
+	UINT64_C(0xEB3593803173E0CE), UINT64_C(0x9C4CD6257C5A3603), UINT64_C(0xAF0C317D32ADAA8A),
+	UINT64_C(0x258E5A80C7204C4B), UINT64_C(0x8B889D624D44885D), UINT64_C(0xF4D14597E660F855),
+	UINT64_C(0xD4347F66EC8941C3), UINT64_C(0xE699ED85B0DFB40D), UINT64_C(0x2472F6207C2D0484),
+	UINT64_C(0xC2A1E7B5B459AEB5), UINT64_C(0xAB4F6451CC1D45EC), UINT64_C(0x63767572AE3D6174),
+	UINT64_C(0xA59E0BD101731A28), UINT64_C(0x116D0016CB948F09), UINT64_C(0x2CF9C8CA052F6E9F),
+	UINT64_C(0x0B090A7560A968E3), UINT64_C(0xABEEDDB2DDE06FF1), UINT64_C(0x58EFC10B06A2068D),
+	UINT64_C(0xC6E57A78FBD986E0), UINT64_C(0x2EAB8CA63CE802D7), UINT64_C(0x14A195640116F336),
+	UINT64_C(0x7C0828DD624EC390), UINT64_C(0xD74BBE77E6116AC7), UINT64_C(0x804456AF10F5FB53),
+	UINT64_C(0xEBE9EA2ADF4321C7), UINT64_C(0x03219A39EE587A30), UINT64_C(0x49787FEF17AF9924),
+	UINT64_C(0xA1E9300CD8520548), UINT64_C(0x5B45E522E4B1B4EF), UINT64_C(0xB49C3B3995091A36),
+	UINT64_C(0xD4490AD526F14431), UINT64_C(0x12A8F216AF9418C2), UINT64_C(0x001F837CC7350524),
+	UINT64_C(0x1877B51E57A764D5), UINT64_C(0xA2853B80F17F58EE), UINT64_C(0x993E1DE72D36D310),
+	UINT64_C(0xB3598080CE64A656), UINT64_C(0x252F59CF0D9F04BB), UINT64_C(0xD23C8E176D113600),
+	UINT64_C(0x1BDA0492E7E4586E), UINT64_C(0x21E0BD5026C619BF), UINT64_C(0x3B097ADAF088F94E),
+	UINT64_C(0x8D14DEDB30BE846E), UINT64_C(0xF95CFFA23AF5F6F4), UINT64_C(0x3871700761B3F743),
+	UINT64_C(0xCA672B91E9E4FA16), UINT64_C(0x64C8E531BFF53B55), UINT64_C(0x241260ED4AD1E87D),
+	UINT64_C(0x106C09B972D2E822), UINT64_C(0x7FBA195410E5CA30), UINT64_C(0x7884D9BC6CB569D8),
+	UINT64_C(0x0647DFEDCD894A29), UINT64_C(0x63573FF03E224774), UINT64_C(0x4FC8E9560F91B123),
+	UINT64_C(0x1DB956E450275779), UINT64_C(0xB8D91274B9E9D4FB), UINT64_C(0xA2EBEE47E2FBFCE1),
+	UINT64_C(0xD9F1F30CCD97FB09), UINT64_C(0xEFED53D75FD64E6B), UINT64_C(0x2E6D02C36017F67F),
+	UINT64_C(0xA9AA4D20DB084E9B), UINT64_C(0xB64BE8D8B25396C1), UINT64_C(0x70CB6AF7C2D5BCF0),
+	UINT64_C(0x98F076A4F7A2322E), UINT64_C(0xBF84470805E69B5F), UINT64_C(0x94C3251F06F90CF3),
+	UINT64_C(0x3E003E616A6591E9), UINT64_C(0xB925A6CD0421AFF3), UINT64_C(0x61BDD1307C66E300),
+	UINT64_C(0xBF8D5108E27E0D48), UINT64_C(0x240AB57A8B888B20), UINT64_C(0xFC87614BAF287E07),
+	UINT64_C(0xEF02CDD06FFDB432), UINT64_C(0xA1082C0466DF6C0A), UINT64_C(0x8215E577001332C8),
+	UINT64_C(0xD39BB9C3A48DB6CF), UINT64_C(0xC4D399FC4707DFAB), UINT64_C(0x26B6C6176014B8D8),
+	UINT64_C(0x24C50874BCA294C8), UINT64_C(0xE65A42BE853A91AD), UINT64_C(0x7396F5015576768A),
+	UINT64_C(0x81624A5AE8BCFA21), UINT64_C(0x66586BC9AF7AC564), UINT64_C(0xE952062CE4421AD3),
+	UINT64_C(0xFB1EA1D6C15E0198), UINT64_C(0x184DB128511A72FA), UINT64_C(0x6E568FCFD000F23F),
+	UINT64_C(0x9671E087F150C31B), UINT64_C(0x1E4E5F8760EA7BC1), UINT64_C(0x9F6596F1D603FC27),
+	UINT64_C(0x6C8A4CC95A1446B4), UINT64_C(0x9732E362FC29EAA9), UINT64_C(0x928566BFF6338A7B),
+	UINT64_C(0xB74636902753B2D9), UINT64_C(0x8397EDDFB1C6C2E0), UINT64_C(0x455898AFB360A7A7),
+	UINT64_C(0x9CF35ACA94B6F448), UINT64_C(0xD9519E62FEF4741F), UINT64_C(0xD7A216910ECD649A),
+	UINT64_C(0x6CA25A505CB9772B), UINT64_C(0x471A2354ACDC746F), UINT64_C(0x78B546A1ECA553D1),
+	UINT64_C(0xE26D0380CF60C95A), UINT64_C(0x24D5992DDE686DC6), UINT64_C(0x58DD1C9BE72BAF71),
+	UINT64_C(0x75D9009E74D2AB26), UINT64_C(0xA6C7C52E7039605C), UINT64_C(0x61F8F21339255596),
+	UINT64_C(0x789D85882555FCB6), UINT64_C(0x34B380FD1645589E), UINT64_C(0x3EDC9C6D8804033D),
+	UINT64_C(0x1106CF10489DD515), UINT64_C(0xE36A46E3C552848C), UINT64_C(0xFA26A1FB403A7A14),
+	UINT64_C(0x2BBEAE45CAB396AB), UINT64_C(0x95324F9A377D014B), UINT64_C(0x1436DA535393754E),
+	UINT64_C(0x944D1D5876BF2957), UINT64_C(0x03D6B48020B1C8BA), UINT64_C(0x0A2CBE9679A70139),
+	UINT64_C(0x4CBDFE92996DADA1), UINT64_C(0xE46759F064DFE2AF), UINT64_C(0x7F8B2769BEB91356),
+	UINT64_C(0x74969FBF8852A4BD), UINT64_C(0xF233C0370052B71E), UINT64_C(0x68F282FA15C15EAE),
+	UINT64_C(0x0E3E882D0C268BC5), UINT64_C(0xA875D67D9561BD0F), UINT64_C(0x7F403ECC1B4BDA66),
+	UINT64_C(0xE53A90BA657DA441), UINT64_C(0x9501C92A317196CC), UINT64_C(0xBB8312D057E62C7E),
+	UINT64_C(0x3EA6816B7DE472C7), UINT64_C(0xFF9865B070E19064), UINT64_C(0x2BA94771FE3C7274),
+	UINT64_C(0xEF79B90D410A38B8), UINT64_C(0x77FB1441D21CAB73), UINT64_C(0xCCCDD04627324C97),
+	UINT64_C(0x765629B8F74E02ED), UINT64_C(0x8AACFC08CA59E0FE), UINT64_C(0xEE76FCEFE00CFCC2),
+	UINT64_C(0x9EFA067B89713A4C), UINT64_C(0x384AE5CB6849648D), UINT64_C(0xB62B09B04E75B3D0),
+	UINT64_C(0x558EF01D88F84CC8), UINT64_C(0x9527D70657C5B75C), UINT64_C(0x217B2F6B257035D7),
+	UINT64_C(0x9046ABE83AE27D7B), UINT64_C(0xB93FBA8B819FCD09), UINT64_C(0x3E58BE3507298EFD),
+	UINT64_C(0xEDB333A1D9727F88), UINT64_C(0x28114A7CEB7D802E), UINT64_C(0xE71AD5D0A4F0D0BF),
+	UINT64_C(0xE23EDDDDFEF1F06A), UINT64_C(0xAFBD4D6EAEF52537), UINT64_C(0x9C8EDFAF3CE5B1FE),
+	UINT64_C(0xB3F5A7AB18104051), UINT64_C(0x4FBD4AF4B1DBCA58), UINT64_C(0x8E640241569CD742),
+	UINT64_C(0x417C1F8A642D9628), UINT64_C(0x5AD2BF21029EC400), UINT64_C(0xB1DAAFDEBB95082F),
+	UINT64_C(0x0E16BECA349CFAE2), UINT64_C(0xEDD8839310A44169), UINT64_C(0xB8926664BFDE4C60),
+	UINT64_C(0xC58FCB1B304CF060), UINT64_C(0x22582C381246AD41), UINT64_C(0x8E5AE0467EDE497B),
+	UINT64_C(0x4E54D5BAEAE786CA), UINT64_C(0xF142DF975FCC9AEA), UINT64_C(0x4CCCB9323B612401),
+	UINT64_C(0x67BCEF05879E7D98), UINT64_C(0x0E43536370D4558C), UINT64_C(0xC3E3C69C1F244260),
+	UINT64_C(0x2DCEBAF9ABB13FA9), UINT64_C(0xAAE459803A8067B5), UINT64_C(0x7B79D3E70780D071),
+	UINT64_C(0x078424BBF65C4B6A), UINT64_C(0xD6B93C99CEEE3B60), UINT64_C(0x9841C0BEF3E7D7E9),
+	UINT64_C(0x08381804EF79EF6B), UINT64_C(0xB10C92BC6AF2E7C0), UINT64_C(0xCE9FB2B934ED48E0),
+	UINT64_C(0x60E093CF49D9A571), UINT64_C(0x7D1C4D443642B324), UINT64_C(0x86DAB7EF4AB02A57),
+	UINT64_C(0x953999FFDCDEB705), UINT64_C(0xF197F74EE602BC3B), UINT64_C(0xA78C01E8B8B9F198),
+	UINT64_C(0xB4327091FC3CA9BF), UINT64_C(0xA98021CE55604D0D), UINT64_C(0xF5CFCDAB9FE1B66A),
+	UINT64_C(0xC446ED1F62016E10), UINT64_C(0x24479735FD143B34), UINT64_C(0xAB70938D98063601),
+	UINT64_C(0x81AEE3675C8532D5), UINT64_C(0x394D2E048F463B3A), UINT64_C(0xACB532599C12A933),
+	UINT64_C(0xC330295D075ECB17), UINT64_C(0xF68797C2E51D48D2), UINT64_C(0x78FAA038651BE5E7),
+	UINT64_C(0x42E58905687DB8A3), UINT64_C(0x87A980EEE8EDD5D8), UINT64_C(0x9AB8D96B604988E6),
+	UINT64_C(0x0493251A17BBC913), UINT64_C(0x7A8B73C3C9967553), UINT64_C(0x1CAD84DE322F3FA7),
+	UINT64_C(0x81A2CAA54AC30449), UINT64_C(0x1333830E079973BF), UINT64_C(0x27EE08ED897E09FA),
+	UINT64_C(0x72C46A29BC7AA719), UINT64_C(0xED69D5E285FB87C6), UINT64_C(0x80E70C7275FD507E),
+	UINT64_C(0x2D41754F95D1DDEB), UINT64_C(0xFD534C7E2298584C), UINT64_C(0x732C7D107D772D5F),
+	UINT64_C(0xDCF756CCED76C8EB), UINT64_C(0x373BF0B0D246A087), UINT64_C(0xCFAA822EF9067D7E),
+	UINT64_C(0x2D439E75A08B8CF5), UINT64_C(0x7EF90F6997074569), UINT64_C(0xFD2DA038493E3F84),
+	UINT64_C(0xF3B8EEE100CBFF9C), UINT64_C(0x5927C899A074858C), UINT64_C(0x6BF701BF50664A23),
+	UINT64_C(0x4B377B293B151E60), UINT64_C(0xD91494FD33A9D308), UINT64_C(0x6C7A6AA76B8490A8),
+	UINT64_C(0xC915753EA185482F), UINT64_C(0xA3E253E6EC4B1DCA), UINT64_C(0xE7AFA37149BF9682),
+	UINT64_C(0x709005676F0761C3), UINT64_C(0x78BF36C06A8FDAED), UINT64_C(0xE356A49347AC23C5),
+	UINT64_C(0x290A15D41F47A02E), UINT64_C(0x120F569634A291DD), UINT64_C(0xC5FB8CD374D5BD0E),
+	UINT64_C(0xD52B71AE1AA114A0), UINT64_C(0xEEA0A559555541AD), UINT64_C(0xA4827ECAFB98781C),
+	UINT64_C(0xF4C276199BCB01E9), UINT64_C(0x7B9056B1D374D65E), UINT64_C(0x402AABCC1253F3FF),
+	UINT64_C(0x4E4ACCB523FD58DE), UINT64_C(0xEE79BBEE035D2B13), UINT64_C(0xE8BF689ADC76D30B),
+	UINT64_C(0xFB31440B338C49A4), UINT64_C(0x010E8F9F9A424EAB), UINT64_C(0xED861EDB3C14A682),
+	UINT64_C(0xEE0329457A055AB6), UINT64_C(0xEB481AD7F78FA6DA), UINT64_C(0xD1EF62145DEDDDF3),
+	UINT64_C(0x170EEAD2DA4F753B), UINT64_C(0xEAB22D563C42AC01), UINT64_C(0xAF6A40C3BEFFCECB),
+	UINT64_C(0xCD2E7E6CF940928D), UINT64_C(0x39EF1484B25CB19E), UINT64_C(0x427A80D986C94374),
+	UINT64_C(0x2C781741A2999991), UINT64_C(0xA0EA5438178F93A2), UINT64_C(0x4137F683441E204D),
+	UINT64_C(0xAC43BA0ECE1D595F), UINT64_C(0xF121D50A7CC1444B), UINT64_C(0x7057B1927B6E7FD1),
+	UINT64_C(0x8CDC78B5F3E1A517), UINT64_C(0xFFE0FC19A5D766CD), UINT64_C(0x0CE05A1EB229DC8A),
+	UINT64_C(0x85385BBDBF0541E8), UINT64_C(0xBDD0D47045E27D47), UINT64_C(0xDE848BBB922A4D29),
+	UINT64_C(0xCA6281F552D3995F), UINT64_C(0x4392DA28DED243AF), UINT64_C(0xE22D66587F8FA653),
+	UINT64_C(0x07E3593635865475), UINT64_C(0x21882618E3D5500E), UINT64_C(0xBAD988042882CBA9),
+	UINT64_C(0xFD5DBF307CE5DDF9), UINT64_C(0x7390F604E5BB3962), UINT64_C(0x1EA338E1838622D7),
+	UINT64_C(0x376A8BD2AEDB4DCE), UINT64_C(0xE0141FC05B83107E), UINT64_C(0x5B738FC461C00D41),
+	UINT64_C(0x2407DEF463C26BA0), UINT64_C(0x4DE2FCBADC3C5E90), UINT64_C(0xDBB4DBD54611A938),
+	UINT64_C(0xB017355DB1A408E0), UINT64_C(0xFFB022979CD25F5E), UINT64_C(0x3360E9DE020929D3),
+	UINT64_C(0x31D71DCE64B2C310), UINT64_C(0xF165B587DF898190), UINT64_C(0xA57E6339DD2CF3A7),
+	UINT64_C(0x1EF6E6DBB1961EC9), UINT64_C(0x70CC73D90BC26E24), UINT64_C(0xE21A6B35DF0C3AD7),
+	UINT64_C(0x003A93D8B2806962), UINT64_C(0x1C99DED33CB890A1), UINT64_C(0xCF3145DE0ADD4289),
+	UINT64_C(0xD0E4427A5514FB72), UINT64_C(0x77C621CC9FB3A483), UINT64_C(0x67A34DAC4356550B),
+	UINT64_C(0xF8D626AAAF278509)
+};
+
+uint64_t zobrist_castling(const struct position *pos) {
+	uint64_t key = 0;
+
+	if (pos->castling_rights[WHITE] & KING_SIDE) {
+		key ^= zobrist_random[768];
+	}
+
+	if (pos->castling_rights[WHITE] & QUEEN_SIDE) {
+		key ^= zobrist_random[769];
+	}
+
+	if (pos->castling_rights[BLACK] & KING_SIDE) {
+		key ^= zobrist_random[770];
+	}
+
+	if (pos->castling_rights[BLACK] & QUEEN_SIDE) {
+		key ^= zobrist_random[771];
+	}
+
+	return key;
+}
+
+uint64_t zobrist_en_passant(const struct position *pos) {
+	int pawn = PIECE(pos->side_to_move, PAWN);
+	int file;
+	int rank;
+
+	if (pos->en_passant_square == NO_SQUARE) {
+		return 0;
+	}
+
+	/* the capturing pawn stands next to the pawn that just moved.           */
+	file = FILE(pos->en_passant_square);
+	rank = RELATIVE(RANK_5, pos->side_to_move);
+
+	if (file > FILE_A && pos->board[SQUARE(file - 1, rank)] == pawn) {
+		return zobrist_random[772 + file];
+	}
+
+	if (file < FILE_H && pos->board[SQUARE(file + 1, rank)] == pawn) {
+		return zobrist_random[772 + file];
+	}
+
+	return 0;
+}
+
+uint64_t zobrist_key(const struct position *pos) {
+	uint64_t key = zobrist_castling(pos) ^ zobrist_en_passant(pos);
+	int square;
+
+	for (square = 0; square < 64; square++) {
+		if (pos->board[square] != NO_PIECE) {
+			key ^= ZOBRIST_PIECE(pos->board[square], square);
+		}
+	}
+
+	if (pos->side_to_move == WHITE) {
+		key ^= ZOBRIST_TURN;
+	}
+
+	return key;
+}
@@ -0,0 +1,51 @@
+/* this program checks that a book written by `chessbot bookgen` stores the  */
+/* start position under the key given in the polyglot book format            */
+/* description, so other tools can read the books we write. it is run by     */
+/* `make test` on a book made from `tools/booktest.pgn`.                     */
+/*                                                                           */
+/* http://hgm.nubati.net/book_format.html                                    */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/* every entry is a 64 bit key, a 16 bit move, a 16 bit weight, and a 32     */
+/* bit learn value, all stored big endian.                                   */
+#define ENTRY_SIZE 16
+
+#define START_KEY UINT64_C(0x463B96181691FC9C)
+
+int main(int argc, char **argv) {
+	unsigned char entry[ENTRY_SIZE];
+	FILE *file;
+	int found = 0;
+
+	if (argc != 2) {
+		fprintf(stderr, "usage: booktest book.bin\n");
+		return EXIT_FAILURE;
+	}
+
+	file = fopen(argv[1], "rb");
+
+	if (!file) {
+		fprintf(stderr, "booktest: could not open %s\n", argv[1]);
+		return EXIT_FAILURE;
+	}
+
+	while (!found && fread(entry, ENTRY_SIZE, 1, file) == 1) {
+		uint64_t key = 0;
+		int index;
+
+		for (index = 0; index < 8; index++) {
+			key = key << 8 | entry[index];
+		}
+
+		found = key == START_KEY;
+	}
+
+	fclose(file);
+
+	printf("start position %s\n", found ? "found" : "not found");
+
+	return found ? EXIT_SUCCESS : EXIT_FAILURE;
+}
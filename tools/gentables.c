@@ -0,0 +1,200 @@
+/* this program writes the attack tables used by the move generator to       */
+/* standard output, as a header with `static const` arrays. it is run by     */
+/* the makefile, which stores the result in `build/tables.h`, so the tables  */
+/* cost nothing at startup and are never out of date.                        */
+/*                                                                           */
+/* squares are numbered like in `types.h`, from 0 for a1 to 63 for h8. lists */
+/* of squares end with -1. directions are numbered 0 to 7, in the order of   */
+/* the offsets in `directions` below. directions 0, 2, 5 and 7 are           */
+/* diagonals, the others are files and ranks.                                */
+
+#include <stdio.h>
+
+static const int directions[8][2] = { { -1, -1 }, { 0, -1 }, { 1, -1 }, { -1, 0 }, { 1, 0 }, { -1, 1 }, { 0, 1 }, { 1, 1 } };
+static const int knight_offsets[8][2] = { { -1, -2 }, { 1, -2 }, { -2, -1 }, { 2, -1 }, { -2, 1 }, { 2, 1 }, { -1, 2 }, { 1, 2 } };
+
+/* returns the square at the offset, or -1 if it is off the board.           */
+static int add_offset(int square, int file_offset, int rank_offset) {
+	int file = square % 8 + file_offset;
+	int rank = square / 8 + rank_offset;
+
+	return file >= 0 && file < 8 && rank >= 0 && rank < 8 ? rank * 8 + file : -1;
+}
+
+/* store the squares at the offsets from the square in `squares`, ending     */
+/* with -1.                                                                  */
+static void offset_squares(int *squares, int square, const int (*offsets)[2], int count) {
+	int index;
+
+	for (index = 0; index < count; index++) {
+		int to_square = add_offset(square, offsets[index][0], offsets[index][1]);
+
+		if (to_square != -1) {
+			*squares++ = to_square;
+		}
+	}
+
+	*squares = -1;
+}
+
+/* store the squares from the square to the edge in the direction in         */
+/* `squares`, ending with -1.                                                */
+static void ray_squares(int *squares, int square, int direction) {
+	int to_square = add_offset(square, directions[direction][0], directions[direction][1]);
+
+	while (to_square != -1) {
+		*squares++ = to_square;
+		to_square = add_offset(to_square, directions[direction][0], directions[direction][1]);
+	}
+
+	*squares = -1;
+}
+
+/* print a list of squares, padded with -1 to the size.                      */
+static void print_list(const int *squares, int size) {
+	int ended = 0;
+	int index;
+
+	printf("{ ");
+
+	for (index = 0; index < size; index++) {
+		ended = ended || squares[index] == -1;
+		printf("%s%d", index > 0 ? ", " : "", ended ? -1 : squares[index]);
+	}
+
+	printf(" }");
+}
+
+static void print_mask(const int *squares) {
+	unsigned long high = 0;
+	unsigned long low = 0;
+
+	for (; *squares != -1; squares++) {
+		if (*squares >= 32) {
+			high |= 1UL << (*squares - 32);
+		} else {
+			low |= 1UL << *squares;
+		}
+	}
+
+	printf("UINT64_C(0x%08lX%08lX)", high, low);
+}
+
+/* print a table of lists, and one of masks if `mask_name` is not `NULL`.    */
+static void print_offset_table(const char *name, const char *mask_name, const int (*offsets)[2], int count) {
+	int squares[9];
+	int square;
+
+	printf("static const signed char %s[64][9] = {\n", name);
+
+	for (square = 0; square < 64; square++) {
+		offset_squares(squares, square, offsets, count);
+		printf("\t");
+		print_list(squares, 9);
+		printf("%s\n", square < 63 ? "," : "");
+	}
+
+	printf("};\n\nstatic const uint64_t %s[64] = {\n", mask_name);
+
+	for (square = 0; square < 64; square++) {
+		offset_squares(squares, square, offsets, count);
+		printf("\t");
+		print_mask(squares);
+		printf("%s\n", square < 63 ? "," : "");
+	}
+
+	printf("};\n\n");
+}
+
+int main(void) {
+	int squares[9];
+	int color;
+	int square;
+	int direction;
+
+	printf("/* generated by tools/gentables.c, do not edit. */\n\n");
+	printf("#ifndef TABLES_H\n#define TABLES_H\n\n#include <stdint.h>\n\n");
+
+	/* knight and king moves, at most 8 squares and the end.                 */
+	print_offset_table("knight_moves", "knight_attacks", knight_offsets, 8);
+	print_offset_table("king_moves", "king_attacks", directions, 8);
+
+	/* pawn attacks, by the color of the pawn.                               */
+	printf("static const signed char pawn_captures[2][64][3] = {\n");
+
+	for (color = 0; color < 2; color++) {
+		printf("\t{\n");
+
+		for (square = 0; square < 64; square++) {
+			int offsets[2][2];
+
+			offsets[0][0] = -1;
+			offsets[0][1] = color == 0 ? 1 : -1;
+			offsets[1][0] = 1;
+			offsets[1][1] = color == 0 ? 1 : -1;
+			offset_squares(squares, square, (const int (*)[2])offsets, 2);
+			printf("\t\t");
+			print_list(squares, 3);
+			printf("%s\n", square < 63 ? "," : "");
+		}
+
+		printf("\t}%s\n", color == 0 ? "," : "");
+	}
+
+	printf("};\n\nstatic const uint64_t pawn_attacks[2][64] = {\n");
+
+	for (color = 0; color < 2; color++) {
+		printf("\t{\n");
+
+		for (square = 0; square < 64; square++) {
+			int offsets[2][2];
+
+			offsets[0][0] = -1;
+			offsets[0][1] = color == 0 ? 1 : -1;
+			offsets[1][0] = 1;
+			offsets[1][1] = color == 0 ? 1 : -1;
+			offset_squares(squares, square, (const int (*)[2])offsets, 2);
+			printf("\t\t");
+			print_mask(squares);
+			printf("%s\n", square < 63 ? "," : "");
+		}
+
+		printf("\t}%s\n", color == 0 ? "," : "");
+	}
+
+	/* rays, the squares from a square to the edge in every direction.       */
+	printf("};\n\nstatic const signed char rays[64][8][8] = {\n");
+
+	for (square = 0; square < 64; square++) {
+		printf("\t{\n");
+
+		for (direction = 0; direction < 8; direction++) {
+			ray_squares(squares, square, direction);
+			printf("\t\t");
+			print_list(squares, 8);
+			printf("%s\n", direction < 7 ? "," : "");
+		}
+
+		printf("\t}%s\n", square < 63 ? "," : "");
+	}
+
+	/* the same rays as masks.                                               */
+	printf("};\n\nstatic const uint64_t ray_masks[64][8] = {\n");
+
+	for (square = 0; square < 64; square++) {
+		printf("\t{\n");
+
+		for (direction = 0; direction < 8; direction++) {
+			ray_squares(squares, square, direction);
+			printf("\t\t");
+			print_mask(squares);
+			printf("%s\n", direction < 7 ? "," : "");
+		}
+
+		printf("\t}%s\n", square < 63 ? "," : "");
+	}
+
+	printf("};\n\n#endif\n");
+
+	return 0;
+}
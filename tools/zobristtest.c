@@ -0,0 +1,49 @@
+/* this program checks the keys of the positions in the polyglot book format */
+/* description against the keys `parse_position` computes, so a book made by */
+/* another tool can be read. it is run by `make test` and prints every key   */
+/* that does not match.                                                      */
+/*                                                                           */
+/* http://hgm.nubati.net/book_format.html                                    */
+
+#include "position.h"
+#include "types.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+struct key_test {
+	const char *fen;
+	uint64_t key;
+};
+
+static const struct key_test tests[] = {
+	{ "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", UINT64_C(0x463B96181691FC9C) },
+	{ "rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq e3 0 1", UINT64_C(0x823C9B50FD114196) },
+	{ "rnbqkbnr/ppp1pppp/8/3p4/4P3/8/PPPP1PPP/RNBQKBNR w KQkq d6 0 2", UINT64_C(0x0756B94461C50FB0) },
+	{ "rnbqkbnr/ppp1pppp/8/3pP3/8/8/PPPP1PPP/RNBQKBNR b KQkq - 0 2", UINT64_C(0x662FAFB965DB29D4) },
+	{ "rnbqkbnr/ppp1p1pp/8/3pPp2/8/8/PPPP1PPP/RNBQKBNR w KQkq f6 0 3", UINT64_C(0x22A48B5A8E47FF78) },
+	{ "rnbqkbnr/ppp1p1pp/8/3pPp2/8/8/PPPPKPPP/RNBQ1BNR b kq - 0 3", UINT64_C(0x652A607CA3F242C1) },
+	{ "rnbq1bnr/ppp1pkpp/8/3pPp2/8/8/PPPPKPPP/RNBQ1BNR w - - 0 4", UINT64_C(0x00FDD303C946BDD9) },
+	{ "rnbqkbnr/p1pppppp/8/8/PpP4P/8/1P1PPPP1/RNBQKBNR b KQkq c3 0 3", UINT64_C(0x3C8123EA7B067637) },
+	{ "rnbqkbnr/p1pppppp/8/8/P6P/R1p5/1P1PPPP1/1NBQKBNR b Kkq - 0 4", UINT64_C(0x5C3F9B829B279560) }
+};
+
+int main(void) {
+	struct position pos;
+	size_t index;
+	int failures = 0;
+
+	for (index = 0; index < sizeof tests / sizeof *tests; index++) {
+		if (parse_position(&pos, tests[index].fen) != SUCCESS) {
+			printf("cannot parse %s\n", tests[index].fen);
+			failures++;
+		} else if (pos.key != tests[index].key) {
+			printf("%s: expected %08lX%08lX, got %08lX%08lX\n", tests[index].fen, (unsigned long)(tests[index].key >> 32), (unsigned long)(tests[index].key & 0xFFFFFFFF), (unsigned long)(pos.key >> 32), (unsigned long)(pos.key & 0xFFFFFFFF));
+			failures++;
+		}
+	}
+
+	printf("%d of %d keys match\n", (int)(sizeof tests / sizeof *tests) - failures, (int)(sizeof tests / sizeof *tests));
+
+	return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}